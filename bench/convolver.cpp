@@ -0,0 +1,80 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "soundiopp/convolver.h"
+
+// Cost of the Convolver in percent of one core per channel, and how much
+// each further second of impulse response adds. Without start() every
+// partition runs on the calling thread, so the wall time is the whole cost
+// of the convolution.
+
+using namespace sio;
+
+static const int sample_rate = 48000;
+static const int channel_count = 2;
+static const int block_size = 256;
+static const int seconds = 10;
+
+static double measure(double impulse_seconds)
+{
+    int length = static_cast<int>(impulse_seconds * sample_rate);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+    std::vector<float> impulse(length);
+    for (float& tap : impulse) {
+        tap = noise(random) * 0.01f;
+    }
+    std::vector<std::vector<float>> buffers(channel_count,
+        std::vector<float>(block_size));
+    std::vector<float*> ptrs;
+    for (auto& buffer : buffers) {
+        for (float& sample : buffer) {
+            sample = noise(random);
+        }
+        ptrs.push_back(buffer.data());
+    }
+
+    Convolver convolver(channel_count, 64, 1024);
+    for (int ch = 0; ch < channel_count; ch++) {
+        convolver.set_impulse(ch, impulse.data(), length);
+    }
+    int blocks = seconds * sample_rate / block_size;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < blocks; i++) {
+        convolver.process(ptrs.data(), ptrs.data(), block_size);
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() / seconds * 100.0;
+}
+
+int main()
+{
+    std::printf("%d channels, %d frame blocks, head 64, tail 1024\n",
+        channel_count, block_size);
+    const double lengths[] = {0.5, 1.0, 2.0, 4.0, 8.0};
+    double first = 0.0;
+    double last = 0.0;
+    for (double impulse_seconds : lengths) {
+        // Best of three
+        double load = measure(impulse_seconds);
+        for (int repeat = 0; repeat < 2; repeat++) {
+            double again = measure(impulse_seconds);
+            if (again < load) {
+                load = again;
+            }
+        }
+        load /= channel_count;
+        std::printf("IR %4.1f s  %5.2f %% per channel  %5.2f %% per channel"
+            " and IR second\n", impulse_seconds, load,
+            load / impulse_seconds);
+        if (first == 0.0) {
+            first = load;
+        }
+        last = load;
+    }
+    std::printf("Each further IR second adds %.2f %% per channel\n",
+        (last - first) / (lengths[4] - lengths[0]));
+    return 0;
+}
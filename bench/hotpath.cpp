@@ -0,0 +1,133 @@
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+
+// Per-call cost of the stream and RingBuffer wrappers. Build once with
+// SOUNDIOPP_INLINE on and once off and compare.
+
+using namespace sio;
+
+static const int iterations = 10000000;
+
+// Hands out the same buffer every time, so the wrappers are all that is
+// measured besides one virtual call
+class NullDriver : public Driver
+{
+public:
+    NullDriver() : m_buffer(1024 * 8)
+    {
+        m_areas[0].ptr = m_buffer.data();
+        m_areas[0].step = 8;
+        m_areas[1].ptr = m_buffer.data() + 4;
+        m_areas[1].step = 8;
+    }
+
+    OutStream create_outstream()
+    {
+        return OutStream(this);
+    }
+
+    virtual ErrorId begin_write(OutStream* outstream,
+        ChannelArea*& areas, int& frame_count) noexcept
+    {
+        (void)outstream;
+        (void)frame_count;
+        areas = m_areas;
+        return ErrorId::None;
+    }
+
+    virtual ErrorId end_write(OutStream* outstream) noexcept
+    {
+        (void)outstream;
+        return ErrorId::None;
+    }
+private:
+    std::vector<char> m_buffer;
+    ChannelArea m_areas[2];
+};
+
+template<typename F>
+static void run(const char* name, F body)
+{
+    // Warm up, then take the best of a few runs
+    for (int i = 0; i < iterations / 10; i++) {
+        body(i);
+    }
+    double best = 0.0;
+    for (int repeat = 0; repeat < 5; repeat++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            body(i);
+        }
+        std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+        double per_call = elapsed.count() / iterations;
+        if (repeat == 0 || per_call < best) {
+            best = per_call;
+        }
+    }
+    std::printf("%-34s %6.2f ns\n", name, best);
+}
+
+int main()
+{
+#ifdef SOUNDIOPP_INLINE
+    std::printf("SOUNDIOPP_INLINE on\n");
+#else
+    std::printf("SOUNDIOPP_INLINE off\n");
+#endif
+    NullDriver driver;
+    OutStream outstream = driver.create_outstream();
+    outstream.set_format(static_cast<FormatId>(SoundIoFormatFloat32NE));
+    outstream.set_sample_rate(48000);
+    outstream.open();
+
+    volatile int sink = 0;
+    run("try_begin_write + try_end_write", [&](int i)
+        {
+            ChannelArea* areas;
+            int frame_count = 256;
+            outstream.try_begin_write(areas, frame_count);
+            areas[0].ptr[0] = static_cast<char>(i);
+            outstream.try_end_write();
+        }
+    );
+    run("begin_write + end_write", [&](int i)
+        {
+            ChannelArea* areas;
+            outstream.begin_write(areas, 256);
+            areas[0].ptr[0] = static_cast<char>(i);
+            outstream.end_write();
+        }
+    );
+    run("get_format + get_bytes_per_frame", [&](int i)
+        {
+            sink = static_cast<int>(outstream.get_format())
+                + outstream.get_bytes_per_frame() + i;
+        }
+    );
+
+    Context context;
+    RingBuffer ring = context.create_ring_buffer(1 << 16);
+    run("RingBuffer write + read", [&](int i)
+        {
+            if (ring.free_count() >= 64) {
+                ring.write_ptr()[0] = static_cast<char>(i);
+                ring.advance_write_ptr(64);
+            }
+            if (ring.fill_count() >= 64) {
+                sink = ring.read_ptr()[0];
+                ring.advance_read_ptr(64);
+            }
+        }
+    );
+    run("RingBuffer fill_count + free_count", [&](int i)
+        {
+            sink = ring.fill_count() + ring.free_count() + i;
+        }
+    );
+    (void)sink;
+    return 0;
+}
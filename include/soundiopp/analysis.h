@@ -0,0 +1,85 @@
+#ifndef SOUNDIOPP_ANALYSIS_H
+#define SOUNDIOPP_ANALYSIS_H
+#include <atomic>
+#include <complex>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "soundiopp.h"
+#include "fft.h"
+#include "lockfree.h"
+
+namespace sio
+{
+    // Hann windowed, overlapping magnitude spectra of a mono signal.
+    // Fed from an AnalysisTap worker thread.
+    class SpectrumAnalyser
+    {
+    public:
+        SpectrumAnalyser(int fft_size, int hop_size);
+        void push(const float* samples, int sample_count);
+        long long read(std::vector<float>& magnitudes) const;
+
+        int get_fft_size() const;
+        int get_hop_size() const;
+        std::function<void(const float*, int)> get_frame_callback();
+        void set_frame_callback(
+            std::function<void(const float*, int)> frame_callback);
+    private:
+        void analyse();
+
+        Fft m_fft;
+        int m_hop_size;
+        std::vector<float> m_window;
+        std::vector<float> m_history;
+        int m_history_pos;
+        int m_history_fill;
+        int m_hop_count;
+        std::vector<float> m_frame;
+        std::vector<std::complex<float>> m_bins;
+        std::vector<float> m_magnitudes;
+        float m_scale;
+        std::function<void(const float*, int)> m_frame_callback;
+
+        mutable std::mutex m_published_mutex;
+        std::vector<float> m_published;
+        long long m_frame_index;
+    };
+
+    // Copies a mono mixdown of a stream into a preallocated queue on the
+    // audio thread. A worker thread drains it into any number of analysers,
+    // which have to outlive the tap and be added before start(). The
+    // channel may be changed while streaming.
+    class AnalysisTap
+    {
+    public:
+        explicit AnalysisTap(int capacity = 1 << 16);
+        ~AnalysisTap();
+        void add_analyser(SpectrumAnalyser* analyser);
+        void start();
+        void stop();
+        void process(FormatId format, const ChannelArea* areas,
+            int channel_count, int frame_count);
+
+        int get_channel() const;
+        void set_channel(int channel);
+        unsigned get_dropped_frames() const;
+    private:
+        static const int chunk_frames = 256;
+
+        void run();
+
+        SpscRing<float> m_queue;
+        std::vector<SpectrumAnalyser*> m_analysers;
+        std::vector<float> m_convert;
+        std::vector<float> m_mix;
+        std::atomic<int> m_channel;
+        std::atomic<unsigned> m_dropped_frames;
+        std::atomic<bool> m_running;
+        std::thread m_worker;
+    };
+}
+
+#endif // SOUNDIOPP_ANALYSIS_H
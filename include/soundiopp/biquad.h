@@ -0,0 +1,105 @@
+#ifndef SOUNDIOPP_BIQUAD_H
+#define SOUNDIOPP_BIQUAD_H
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "soundiopp.h"
+#include "lockfree.h"
+
+namespace sio
+{
+    // Normalised coefficients, a0 is 1. The designs follow the RBJ audio
+    // EQ cookbook, frequencies are in Hz.
+    struct BiquadCoeffs
+    {
+        float b0;
+        float b1;
+        float b2;
+        float a1;
+        float a2;
+
+        static BiquadCoeffs identity();
+        static BiquadCoeffs lowpass(double frequency, double q,
+            double sample_rate);
+        static BiquadCoeffs highpass(double frequency, double q,
+            double sample_rate);
+        static BiquadCoeffs bandpass(double frequency, double q,
+            double sample_rate);
+        static BiquadCoeffs notch(double frequency, double q,
+            double sample_rate);
+        static BiquadCoeffs peaking(double frequency, double q,
+            double gain_db, double sample_rate);
+        static BiquadCoeffs low_shelf(double frequency, double q,
+            double gain_db, double sample_rate);
+        static BiquadCoeffs high_shelf(double frequency, double q,
+            double gain_db, double sample_rate);
+    };
+
+    // Cascades of transposed direct form II biquads for many channels.
+    // Channels are processed lane_width at a time with the coefficients
+    // and state laid out per lane, so the inner loops vectorise. New
+    // coefficients may be set from one control thread at a time and are
+    // ramped in linearly over ramp_frames. Every stage starts as identity.
+    class BiquadBank
+    {
+    public:
+        static const int lane_width = 8;
+        static const int ramp_block = 16;
+
+        BiquadBank(int channel_count, int stage_count,
+            int ramp_frames = 1024);
+        void set_stage(int channel, int stage, const BiquadCoeffs& coeffs);
+        void process(float* const* channels, int frame_count);
+        bool process(FormatId format, const ChannelArea* areas,
+            int channel_count, int frame_count);
+        void reset();
+
+        int get_channel_count() const;
+        int get_stage_count() const;
+        int get_ramp_frames() const;
+    private:
+        struct Lanes
+        {
+            float b0[lane_width];
+            float b1[lane_width];
+            float b2[lane_width];
+            float a1[lane_width];
+            float a2[lane_width];
+        };
+
+        struct State
+        {
+            float z1[lane_width];
+            float z2[lane_width];
+        };
+
+        template<typename Sample>
+        void process_areas(const ChannelArea* areas, int frame_count);
+        void update();
+        void step_ramp();
+        void filter(int group, float* block, int frame_count);
+
+        int m_channel_count;
+        int m_stage_count;
+        int m_group_count;
+        int m_ramp_frames;
+        // Indexed by group * stage_count + stage
+        std::vector<Lanes> m_current;
+        std::vector<Lanes> m_target;
+        std::vector<Lanes> m_delta;
+        std::vector<State> m_state;
+        std::vector<float> m_block;
+        std::vector<ChannelArea> m_planar_areas;
+        int m_ramp_steps;
+        int m_block_pos;
+        unsigned m_version_seen;
+
+        std::unique_ptr<SeqLock<BiquadCoeffs>[]> m_pending;
+        std::atomic<unsigned> m_version;
+        std::mutex m_control_mutex;
+    };
+}
+
+#endif // SOUNDIOPP_BIQUAD_H
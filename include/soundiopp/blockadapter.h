@@ -0,0 +1,322 @@
+#ifndef SOUNDIOPP_BLOCKADAPTER_H
+#define SOUNDIOPP_BLOCKADAPTER_H
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+
+#include "soundiopp.h"
+
+namespace sio
+{
+    // Planar float buffer for one block, every channel aligned to a cache line
+    template<int BlockSize>
+    class BlockBuffer
+    {
+    public:
+        static const int alignment = 64;
+
+        BlockBuffer();
+        void resize(int channel_count);
+        int get_channel_count() const;
+        float* const* channels();
+    private:
+        std::vector<float> m_storage;
+        std::vector<float*> m_channels;
+    };
+
+    // Presents a fixed-size block interface on top of the variable sized
+    // write callback. Streams must use the native float32 format.
+    template<int BlockSize>
+    class OutBlockAdapter
+    {
+    public:
+        static const int block_size = BlockSize;
+
+        OutBlockAdapter();
+        void attach(OutStream* outstream);
+        int get_buffered_frames() const;
+        double get_added_latency() const;
+
+        std::function<void(OutStream*, float* const*, int)>
+            get_process_callback();
+        void set_process_callback(
+            std::function<void(OutStream*, float* const*, int)>
+                process_callback);
+    private:
+        void write(OutStream* outstream, int frame_count_min,
+            int frame_count_max);
+
+        BlockBuffer<BlockSize> m_block;
+        int m_position;
+        int m_sample_rate;
+        std::function<void(OutStream*, float* const*, int)> m_process_callback;
+    };
+
+    template<int BlockSize>
+    class InBlockAdapter
+    {
+    public:
+        static const int block_size = BlockSize;
+
+        InBlockAdapter();
+        void attach(InStream* instream);
+        int get_buffered_frames() const;
+        double get_added_latency() const;
+
+        std::function<void(InStream*, const float* const*, int)>
+            get_process_callback();
+        void set_process_callback(
+            std::function<void(InStream*, const float* const*, int)>
+                process_callback);
+    private:
+        void read(InStream* instream, int frame_count_min,
+            int frame_count_max);
+
+        BlockBuffer<BlockSize> m_block;
+        int m_position;
+        int m_sample_rate;
+        std::function<void(InStream*, const float* const*, int)>
+            m_process_callback;
+    };
+
+    // BlockBuffer
+
+    template<int BlockSize>
+    BlockBuffer<BlockSize>::BlockBuffer()
+    {
+        static_assert(BlockSize > 0, "BlockSize must be positive");
+    }
+
+    template<int BlockSize>
+    void BlockBuffer<BlockSize>::resize(int channel_count)
+    {
+        const int floats_per_line = alignment / sizeof(float);
+        int stride = (BlockSize + floats_per_line - 1)
+            / floats_per_line * floats_per_line;
+        m_storage.assign(stride * channel_count + floats_per_line, 0.0f);
+        m_channels.resize(channel_count);
+
+        uintptr_t base = reinterpret_cast<uintptr_t>(m_storage.data());
+        base = (base + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+        for (int ch = 0; ch < channel_count; ch++) {
+            m_channels[ch] = reinterpret_cast<float*>(base) + ch * stride;
+        }
+    }
+
+    template<int BlockSize>
+    int BlockBuffer<BlockSize>::get_channel_count() const
+    {
+        return static_cast<int>(m_channels.size());
+    }
+
+    template<int BlockSize>
+    float* const* BlockBuffer<BlockSize>::channels()
+    {
+        return m_channels.data();
+    }
+
+    // OutBlockAdapter
+
+    template<int BlockSize>
+    OutBlockAdapter<BlockSize>::OutBlockAdapter()
+    {
+        m_position = BlockSize;
+        m_sample_rate = 0;
+    }
+
+    template<int BlockSize>
+    void OutBlockAdapter<BlockSize>::attach(OutStream* outstream)
+    {
+        if (outstream->get_format() !=
+                static_cast<FormatId>(SoundIoFormatFloat32NE)) {
+            throw soundio_error(ErrorId::IncompatibleDevice);
+        }
+        m_block.resize(outstream->get_layout().get_channel_count());
+        m_position = BlockSize;
+        m_sample_rate = outstream->get_sample_rate();
+        outstream->set_write_callback(
+            [this](OutStream* stream, int frame_count_min, int frame_count_max)
+            {
+                write(stream, frame_count_min, frame_count_max);
+            }
+        );
+    }
+
+    template<int BlockSize>
+    int OutBlockAdapter<BlockSize>::get_buffered_frames() const
+    {
+        return BlockSize - m_position;
+    }
+
+    template<int BlockSize>
+    double OutBlockAdapter<BlockSize>::get_added_latency() const
+    {
+        // A block is rendered as soon as its first frame is requested, so
+        // the last frame of it sits in the residual for BlockSize - 1 frames
+        return static_cast<double>(BlockSize - 1) / m_sample_rate;
+    }
+
+    template<int BlockSize>
+    std::function<void(OutStream*, float* const*, int)>
+        OutBlockAdapter<BlockSize>::get_process_callback()
+    {
+        return m_process_callback;
+    }
+
+    template<int BlockSize>
+    void OutBlockAdapter<BlockSize>::set_process_callback(
+        std::function<void(OutStream*, float* const*, int)> process_callback)
+    {
+        m_process_callback = process_callback;
+    }
+
+    template<int BlockSize>
+    void OutBlockAdapter<BlockSize>::write(
+        OutStream* outstream, int frame_count_min, int frame_count_max)
+    {
+        (void)frame_count_min;
+        int channel_count = m_block.get_channel_count();
+        float* const* channels = m_block.channels();
+        int frames_left = frame_count_max;
+
+        while (frames_left > 0) {
+            ChannelArea* areas;
+            int frame_count = outstream->begin_write(areas, frames_left);
+            if (frame_count == 0) {
+                break;
+            }
+
+            int frame = 0;
+            while (frame < frame_count) {
+                if (m_position == BlockSize) {
+                    m_process_callback(outstream, channels, channel_count);
+                    m_position = 0;
+                }
+                int chunk = BlockSize - m_position;
+                if (chunk > frame_count - frame) {
+                    chunk = frame_count - frame;
+                }
+                for (int ch = 0; ch < channel_count; ch++) {
+                    const float* src = channels[ch] + m_position;
+                    char* dst = areas[ch].ptr + frame * areas[ch].step;
+                    for (int i = 0; i < chunk; i++) {
+                        std::memcpy(dst, src + i, sizeof(float));
+                        dst += areas[ch].step;
+                    }
+                }
+                m_position += chunk;
+                frame += chunk;
+            }
+
+            outstream->end_write();
+            frames_left -= frame_count;
+        }
+    }
+
+    // InBlockAdapter
+
+    template<int BlockSize>
+    InBlockAdapter<BlockSize>::InBlockAdapter()
+    {
+        m_position = 0;
+        m_sample_rate = 0;
+    }
+
+    template<int BlockSize>
+    void InBlockAdapter<BlockSize>::attach(InStream* instream)
+    {
+        if (instream->get_format() !=
+                static_cast<FormatId>(SoundIoFormatFloat32NE)) {
+            throw soundio_error(ErrorId::IncompatibleDevice);
+        }
+        m_block.resize(instream->get_layout().get_channel_count());
+        m_position = 0;
+        m_sample_rate = instream->get_sample_rate();
+        instream->set_read_callback(
+            [this](InStream* stream, int frame_count_min, int frame_count_max)
+            {
+                read(stream, frame_count_min, frame_count_max);
+            }
+        );
+    }
+
+    template<int BlockSize>
+    int InBlockAdapter<BlockSize>::get_buffered_frames() const
+    {
+        return m_position;
+    }
+
+    template<int BlockSize>
+    double InBlockAdapter<BlockSize>::get_added_latency() const
+    {
+        // The first frame of a block waits for the remaining BlockSize - 1
+        return static_cast<double>(BlockSize - 1) / m_sample_rate;
+    }
+
+    template<int BlockSize>
+    std::function<void(InStream*, const float* const*, int)>
+        InBlockAdapter<BlockSize>::get_process_callback()
+    {
+        return m_process_callback;
+    }
+
+    template<int BlockSize>
+    void InBlockAdapter<BlockSize>::set_process_callback(
+        std::function<void(InStream*, const float* const*, int)>
+            process_callback)
+    {
+        m_process_callback = process_callback;
+    }
+
+    template<int BlockSize>
+    void InBlockAdapter<BlockSize>::read(
+        InStream* instream, int frame_count_min, int frame_count_max)
+    {
+        (void)frame_count_min;
+        int channel_count = m_block.get_channel_count();
+        float* const* channels = m_block.channels();
+        int frames_left = frame_count_max;
+
+        while (frames_left > 0) {
+            ChannelArea* areas;
+            int frame_count = instream->begin_read(areas, frames_left);
+            if (frame_count == 0) {
+                break;
+            }
+
+            int frame = 0;
+            while (frame < frame_count) {
+                int chunk = BlockSize - m_position;
+                if (chunk > frame_count - frame) {
+                    chunk = frame_count - frame;
+                }
+                for (int ch = 0; ch < channel_count; ch++) {
+                    float* dst = channels[ch] + m_position;
+                    if (areas == nullptr) {
+                        // Hole in the buffer, fill with silence
+                        std::memset(dst, 0, chunk * sizeof(float));
+                        continue;
+                    }
+                    const char* src = areas[ch].ptr + frame * areas[ch].step;
+                    for (int i = 0; i < chunk; i++) {
+                        std::memcpy(dst + i, src, sizeof(float));
+                        src += areas[ch].step;
+                    }
+                }
+                m_position += chunk;
+                frame += chunk;
+
+                if (m_position == BlockSize) {
+                    m_process_callback(instream, channels, channel_count);
+                    m_position = 0;
+                }
+            }
+
+            instream->end_read();
+            frames_left -= frame_count;
+        }
+    }
+}
+
+#endif // SOUNDIOPP_BLOCKADAPTER_H
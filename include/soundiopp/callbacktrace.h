@@ -0,0 +1,145 @@
+#ifndef SOUNDIOPP_CALLBACKTRACE_H
+#define SOUNDIOPP_CALLBACKTRACE_H
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "soundiopp.h"
+
+namespace sio
+{
+    enum class CallbackEventType {
+        // A callback with its requested frame range
+        Callback,
+        // Frames granted by one begin_write or begin_read, stored in
+        // frame_count_max
+        Frames,
+        // Underflow or overflow
+        Xrun
+    };
+
+    struct CallbackEvent
+    {
+        CallbackEventType type;
+        // Nanoseconds since the first callback
+        uint64_t time;
+        int frame_count_min;
+        int frame_count_max;
+    };
+
+    // The callback sequence a backend produced for one stream, saved as a
+    // compact binary file of varint deltas
+    struct CallbackTrace
+    {
+        CallbackTrace();
+        void save(const std::string& path) const;
+        void load(const std::string& path);
+
+        DeviceAimId aim;
+        FormatId format;
+        int sample_rate;
+        std::vector<ChannelId> channels;
+        unsigned long long dropped_events;
+        std::vector<CallbackEvent> events;
+    };
+
+    // Records the callbacks, granted frame counts and xruns of a live
+    // stream. Attach it with set_recorder(). Events go into a preallocated
+    // array without locking; once it is full further events are dropped.
+    // Read the trace after the stream stopped.
+    class CallbackRecorder
+    {
+    public:
+        explicit CallbackRecorder(int max_events = 1 << 20);
+        CallbackRecorder(const CallbackRecorder&) = delete;
+        CallbackRecorder& operator=(const CallbackRecorder&) = delete;
+
+        void callback(OutStream* outstream,
+            int frame_count_min, int frame_count_max);
+        void callback(InStream* instream,
+            int frame_count_min, int frame_count_max);
+        void frames(int frame_count);
+        void xrun();
+        void clear();
+        CallbackTrace get_trace() const;
+        void save(const std::string& path) const;
+
+        int get_event_count() const;
+        unsigned long long get_dropped_events() const;
+    private:
+        void start(DeviceAimId aim, const SoundIoChannelLayout& layout,
+            int format, int sample_rate);
+        void record(CallbackEventType type, uint64_t time,
+            int frame_count_min, int frame_count_max);
+
+        std::unique_ptr<CallbackEvent[]> m_events;
+        int m_max_events;
+        std::atomic<int> m_event_count;
+        std::atomic<unsigned long long> m_dropped_events;
+        // Stream parameters, captured by the first callback
+        bool m_started;
+        uint64_t m_start_time;
+        uint64_t m_last_time;
+        DeviceAimId m_aim;
+        FormatId m_format;
+        int m_sample_rate;
+        int m_channel_count;
+        ChannelId m_channels[SOUNDIO_MAX_CHANNELS];
+    };
+
+    // Drives a stream through a recorded trace offline, with the same
+    // frame_count_min, frame_count_max and granted frame counts in the same
+    // order. As fast as possible by default, or paced like the recording.
+    // Input streams read silence. Each callback's duration is measured so
+    // replays can be compared across builds.
+    class CallbackReplayer : public Driver
+    {
+    public:
+        CallbackReplayer();
+        void load(const std::string& path);
+        OutStream create_outstream();
+        InStream create_instream();
+        int replay(int callback_count = -1);
+        void rewind();
+
+        const CallbackTrace& get_trace() const;
+        void set_trace(const CallbackTrace& trace);
+        bool get_realtime() const;
+        void set_realtime(bool realtime);
+        size_t get_position() const;
+        const std::vector<double>& get_callback_seconds() const;
+
+        using Driver::open;
+        using Driver::close;
+        virtual void open(OutStream* outstream);
+        virtual void close(OutStream* outstream);
+        virtual ErrorId begin_write(OutStream* outstream,
+            ChannelArea*& areas, int& frame_count) noexcept;
+        virtual ErrorId end_write(OutStream* outstream) noexcept;
+        virtual void open(InStream* instream);
+        virtual void close(InStream* instream);
+        virtual ErrorId begin_read(InStream* instream,
+            ChannelArea*& areas, int& frame_count) noexcept;
+        virtual ErrorId end_read(InStream* instream) noexcept;
+    private:
+        void prepare(int bytes_per_frame, int bytes_per_sample,
+            int channel_count);
+        int grant(int frame_count);
+
+        CallbackTrace m_trace;
+        SoundIoOutStream* m_outstream;
+        SoundIoInStream* m_instream;
+        bool m_realtime;
+        size_t m_position;
+        int m_budget;
+        int m_granted;
+        int m_max_frames;
+        std::vector<char> m_buffer;
+        std::vector<ChannelArea> m_areas;
+        std::vector<double> m_callback_seconds;
+    };
+}
+
+#endif // SOUNDIOPP_CALLBACKTRACE_H
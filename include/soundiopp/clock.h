@@ -0,0 +1,48 @@
+#ifndef SOUNDIOPP_CLOCK_H
+#define SOUNDIOPP_CLOCK_H
+#include <atomic>
+
+#include "soundiopp.h"
+#include "lockfree.h"
+
+namespace sio
+{
+    // Maps stream frame positions to the monotonic clock. Streams feed it
+    // one observation per callback once attached with set_clock(), a second
+    // order delay-locked loop smooths out the scheduling jitter. Queries are
+    // lock-free and may come from any thread.
+    class StreamClock
+    {
+    public:
+        StreamClock();
+        void reset();
+        void update(double time, int sample_rate);
+        void advance(int frame_count);
+        double frame_to_time(long long frame) const;
+        long long time_to_frame(double time) const;
+        static double now();
+
+        long long get_position() const;
+        double get_rate() const;
+        double get_bandwidth() const;
+        void set_bandwidth(double bandwidth);
+        double get_reset_threshold() const;
+        void set_reset_threshold(double threshold);
+    private:
+        struct State
+        {
+            long long frame;
+            double time;
+            double period;
+        };
+
+        SeqLock<State> m_state;
+        State m_filter;
+        bool m_locked;
+        std::atomic<long long> m_position;
+        double m_bandwidth;
+        double m_reset_threshold;
+    };
+}
+
+#endif // SOUNDIOPP_CLOCK_H
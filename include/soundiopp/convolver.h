@@ -0,0 +1,135 @@
+#ifndef SOUNDIOPP_CONVOLVER_H
+#define SOUNDIOPP_CONVOLVER_H
+#include <atomic>
+#include <complex>
+#include <thread>
+#include <vector>
+
+#include "soundiopp.h"
+#include "dither.h"
+#include "fft.h"
+
+namespace sio
+{
+    // Convolves every channel with its own impulse response without adding
+    // latency. The first head_size taps are applied directly, the taps up
+    // to 2 * tail_size in head_size partitions and the rest in tail_size
+    // partitions. The tail partitions run one tail block ahead of when
+    // they are needed, on the worker thread once start() was called and on
+    // the audio thread otherwise. The audio thread never waits for the
+    // worker: a block that is not done in time is computed on the audio
+    // thread and the worker's result dropped, get_late_blocks() counts
+    // those. Impulses have to be set while no audio is processed.
+    class Convolver
+    {
+    public:
+        static const int max_block = 1024;
+
+        Convolver(int channel_count, int head_size = 64,
+            int tail_size = 1024);
+        ~Convolver();
+        Convolver(const Convolver&) = delete;
+        Convolver& operator=(const Convolver&) = delete;
+
+        void set_impulse(int channel, const float* impulse, int length);
+        void process(const float* const* input, float* const* output,
+            int frame_count);
+        bool process(FormatId format, const ChannelArea* areas,
+            int channel_count, int frame_count);
+        void reset();
+        void start();
+        void stop();
+
+        int get_channel_count() const;
+        int get_head_size() const;
+        int get_tail_size() const;
+        unsigned get_late_blocks() const;
+    private:
+        enum TailState {
+            TailIdle,
+            TailQueued,
+            TailRunning,
+            TailDone
+        };
+
+        // FFT and buffers of one thread working on a stage
+        struct Scratch
+        {
+            explicit Scratch(int block_size);
+
+            Fft fft;
+            std::vector<std::complex<float>> spectrum;
+            std::vector<float> time;
+        };
+
+        // Uniformly partitioned overlap-save convolution with a frequency
+        // domain delay line. Spare slots keep the newest pushes from
+        // overwriting what a late convolve() still reads.
+        struct Stage
+        {
+            Stage(int block_size, int spare_slots);
+            void set_filter(const float* taps, int length);
+            void push(const float* window);
+            void convolve(int pos, Scratch& scratch, float* output) const;
+            void process(const float* window, float* output);
+            void reset();
+
+            int block_size;
+            int spare_slots;
+            Scratch scratch;
+            std::vector<std::vector<std::complex<float>>> filters;
+            std::vector<std::vector<std::complex<float>>> delay_line;
+            // Slot of the newest push
+            int delay_pos;
+        };
+
+        struct Channel
+        {
+            Channel(int head_size, int tail_size);
+
+            std::vector<float> head;
+            // Previous and current head block, also the direct history
+            std::vector<float> input;
+            Stage early;
+            std::vector<float> early_output;
+            std::vector<float> tail_input;
+            // Written by the worker
+            std::vector<float> tail_result;
+            // Written by the audio thread when it computes a block itself
+            std::vector<float> tail_spare;
+            std::vector<float> tail_output;
+            Stage late;
+            Scratch worker;
+        };
+
+        void advance(int frame_count);
+        void finish_tail();
+        void start_tail();
+        void compute_tail();
+        void run();
+
+        std::vector<Channel> m_channels;
+        int m_head_size;
+        int m_tail_size;
+        int m_head_pos;
+        int m_tail_pos;
+        std::vector<std::vector<float>> m_convert;
+        std::vector<float*> m_convert_ptrs;
+        Dither m_dither;
+        std::atomic<int> m_tail_state;
+        // Delay line slot of the queued block, set before it is queued
+        int m_tail_slot;
+        // Audio thread: tail blocks since a late block was given up on
+        // while the worker still ran it, the next block was pushed while
+        // the worker was busy, and the tail was dropped because the worker
+        // fell too far behind
+        int m_abandoned;
+        bool m_tail_inline;
+        bool m_stalled;
+        std::atomic<unsigned> m_late_blocks;
+        std::atomic<bool> m_running;
+        std::thread m_worker;
+    };
+}
+
+#endif // SOUNDIOPP_CONVOLVER_H
@@ -0,0 +1,58 @@
+#ifndef SOUNDIOPP_DEVICECONFIG_H
+#define SOUNDIOPP_DEVICECONFIG_H
+#include <map>
+#include <string>
+#include <vector>
+
+#include "soundiopp.h"
+
+namespace sio
+{
+    // Everything needed to reopen a stream without negotiating it again
+    struct StreamConfig
+    {
+        BackendId backend;
+        DeviceAimId aim;
+        std::string device_id;
+        bool is_raw;
+        // Where the device was last seen, checked before searching
+        int device_index;
+        FormatId format;
+        int sample_rate;
+        std::vector<ChannelId> channels;
+        double software_latency;
+    };
+
+    // Last known good stream configurations, keyed by a name the
+    // application picks, persisted to a small text file. open_outstream()
+    // and open_instream() go straight to the stored device and settings
+    // and let open() validate them; when they return false the caller
+    // negotiates as usual and stores the result.
+    class DeviceConfigCache
+    {
+    public:
+        explicit DeviceConfigCache(const std::string& path);
+        bool load();
+        void save() const;
+
+        bool get(const std::string& key, StreamConfig& config) const;
+        void set(const std::string& key, const StreamConfig& config);
+        void remove(const std::string& key);
+        void store(const std::string& key, OutStream& outstream);
+        void store(const std::string& key, InStream& instream);
+        bool open_outstream(Context& context, const std::string& key,
+            Device& device, OutStream& outstream);
+        bool open_instream(Context& context, const std::string& key,
+            Device& device, InStream& instream);
+
+        std::string get_path() const;
+    private:
+        bool find_device(Context& context, const StreamConfig& config,
+            DeviceAimId aim, Device& device);
+
+        std::string m_path;
+        std::map<std::string, StreamConfig> m_configs;
+    };
+}
+
+#endif // SOUNDIOPP_DEVICECONFIG_H
@@ -0,0 +1,40 @@
+#ifndef SOUNDIOPP_DITHER_H
+#define SOUNDIOPP_DITHER_H
+#include <cstdint>
+
+#include "soundiopp.h"
+
+namespace sio
+{
+    enum class DitherMode {
+        None,
+        Tpdf,
+        NoiseShaped
+    };
+
+    // Converts planar float blocks into the stream format. Integer formats
+    // are rounded with optional triangular dither, NoiseShaped additionally
+    // feeds the quantisation error back through a second order filter to
+    // move the noise towards Nyquist. Every channel keeps its own generator
+    // and filter state, so use one instance per stream.
+    class Dither
+    {
+    public:
+        explicit Dither(DitherMode mode = DitherMode::Tpdf, uint32_t seed = 1);
+        bool write(const float* const* channels, FormatId format,
+            const ChannelArea* areas, int channel_count, int frame_count);
+        void reset();
+
+        DitherMode get_mode() const;
+        void set_mode(DitherMode mode);
+    private:
+        friend struct DitherVisitor;
+
+        DitherMode m_mode;
+        uint32_t m_seed;
+        uint32_t m_random[SOUNDIO_MAX_CHANNELS];
+        float m_error[SOUNDIO_MAX_CHANNELS][2];
+    };
+}
+
+#endif // SOUNDIOPP_DITHER_H
@@ -0,0 +1,29 @@
+#ifndef SOUNDIOPP_FFT_H
+#define SOUNDIOPP_FFT_H
+#include <complex>
+#include <vector>
+
+namespace sio
+{
+    // Real to complex FFT for power of two sizes, computed as a half size
+    // complex FFT. forward() produces size / 2 + 1 bins, inverse() expects
+    // the same and scales by 1 / size.
+    class Fft
+    {
+    public:
+        explicit Fft(int size);
+        int get_size() const;
+        void forward(const float* input, std::complex<float>* output);
+        void inverse(const std::complex<float>* input, float* output);
+    private:
+        void transform(std::complex<float>* data, bool inverse);
+
+        int m_size;
+        std::vector<int> m_bit_reverse;
+        std::vector<std::complex<float>> m_twiddles;
+        std::vector<std::complex<float>> m_split_twiddles;
+        std::vector<std::complex<float>> m_work;
+    };
+}
+
+#endif // SOUNDIOPP_FFT_H
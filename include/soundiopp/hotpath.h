@@ -0,0 +1,232 @@
+#ifndef SOUNDIOPP_HOTPATH_H
+#define SOUNDIOPP_HOTPATH_H
+
+#include "soundiopp.h"
+#include "meter.h"
+#include "analysis.h"
+#include "callbacktrace.h"
+#include "clock.h"
+#include "trace.h"
+
+// Wrappers called from inside stream callbacks. With SOUNDIOPP_INLINE
+// defined they are included by soundiopp.h and inline into user code,
+// otherwise src/hotpath.cpp compiles them into the library. Don't include
+// this header directly. Nothing in here throws, so code built without
+// exceptions can use the try_ variants.
+#ifdef SOUNDIOPP_INLINE
+#define SOUNDIOPP_HOT inline
+#else
+#define SOUNDIOPP_HOT
+#endif
+
+namespace sio
+{
+    // OutStream
+
+    SOUNDIOPP_HOT ErrorId OutStream::try_begin_write(
+        ChannelArea*& areas, int& frame_count) noexcept
+    {
+        ErrorId err;
+        if (m_driver != nullptr) {
+            err = m_driver->begin_write(this, areas, frame_count);
+        } else {
+            err = static_cast<ErrorId>(soundio_outstream_begin_write(
+                m_outstream, &areas, &frame_count));
+        }
+        if (err != ErrorId::None) {
+            return err;
+        }
+        m_write_areas = areas;
+        m_write_frames = frame_count;
+        if (m_recorder != nullptr) {
+            m_recorder->frames(frame_count);
+        }
+        if (m_tracer != nullptr) {
+            m_tracer->counter("write_frames", frame_count);
+            m_tracer->begin("write");
+        }
+        return ErrorId::None;
+    }
+
+    SOUNDIOPP_HOT ErrorId OutStream::try_end_write() noexcept
+    {
+        if (m_meter != nullptr) {
+            m_meter->process(get_format(), m_write_areas,
+                m_outstream->layout.channel_count, m_write_frames);
+        }
+        if (m_tap != nullptr) {
+            m_tap->process(get_format(), m_write_areas,
+                m_outstream->layout.channel_count, m_write_frames);
+        }
+        if (m_clock != nullptr) {
+            m_clock->advance(m_write_frames);
+        }
+        if (m_tracer != nullptr) {
+            m_tracer->end("write");
+        }
+        if (m_driver != nullptr) {
+            return m_driver->end_write(this);
+        }
+        return static_cast<ErrorId>(soundio_outstream_end_write(m_outstream));
+    }
+
+    SOUNDIOPP_HOT Device* OutStream::get_device()
+    {
+        return m_device;
+    }
+
+    SOUNDIOPP_HOT Driver* OutStream::get_driver()
+    {
+        return m_driver;
+    }
+
+    SOUNDIOPP_HOT FormatId OutStream::get_format() const
+    {
+        return static_cast<FormatId>(m_outstream->format);
+    }
+
+    SOUNDIOPP_HOT int OutStream::get_sample_rate() const
+    {
+        return m_outstream->sample_rate;
+    }
+
+    SOUNDIOPP_HOT void* OutStream::get_userdata()
+    {
+        return m_userdata;
+    }
+
+    SOUNDIOPP_HOT int OutStream::get_bytes_per_frame() const
+    {
+        return m_outstream->bytes_per_frame;
+    }
+
+    SOUNDIOPP_HOT int OutStream::get_bytes_per_sample() const
+    {
+        return m_outstream->bytes_per_sample;
+    }
+
+    // InStream
+
+    SOUNDIOPP_HOT ErrorId InStream::try_begin_read(
+        ChannelArea*& areas, int& frame_count) noexcept
+    {
+        ErrorId err;
+        if (m_driver != nullptr) {
+            err = m_driver->begin_read(this, areas, frame_count);
+        } else {
+            err = static_cast<ErrorId>(soundio_instream_begin_read(
+                m_instream, &areas, &frame_count));
+        }
+        if (err != ErrorId::None) {
+            return err;
+        }
+        m_read_frames = frame_count;
+        if (m_recorder != nullptr) {
+            m_recorder->frames(frame_count);
+        }
+        if (m_tracer != nullptr) {
+            m_tracer->counter("read_frames", frame_count);
+            m_tracer->begin("read");
+        }
+        // areas is null for holes in the buffer
+        if (m_meter != nullptr && areas != nullptr) {
+            m_meter->process(get_format(), areas,
+                m_instream->layout.channel_count, frame_count);
+        }
+        if (m_tap != nullptr && areas != nullptr) {
+            m_tap->process(get_format(), areas,
+                m_instream->layout.channel_count, frame_count);
+        }
+        return ErrorId::None;
+    }
+
+    SOUNDIOPP_HOT ErrorId InStream::try_end_read() noexcept
+    {
+        if (m_clock != nullptr) {
+            m_clock->advance(m_read_frames);
+        }
+        if (m_tracer != nullptr) {
+            m_tracer->end("read");
+        }
+        if (m_driver != nullptr) {
+            return m_driver->end_read(this);
+        }
+        return static_cast<ErrorId>(soundio_instream_end_read(m_instream));
+    }
+
+    SOUNDIOPP_HOT Device* InStream::get_device()
+    {
+        return m_device;
+    }
+
+    SOUNDIOPP_HOT Driver* InStream::get_driver()
+    {
+        return m_driver;
+    }
+
+    SOUNDIOPP_HOT FormatId InStream::get_format() const
+    {
+        return static_cast<FormatId>(m_instream->format);
+    }
+
+    SOUNDIOPP_HOT int InStream::get_sample_rate() const
+    {
+        return m_instream->sample_rate;
+    }
+
+    SOUNDIOPP_HOT void* InStream::get_userdata()
+    {
+        return m_userdata;
+    }
+
+    SOUNDIOPP_HOT int InStream::get_bytes_per_frame() const
+    {
+        return m_instream->bytes_per_frame;
+    }
+
+    SOUNDIOPP_HOT int InStream::get_bytes_per_sample() const
+    {
+        return m_instream->bytes_per_sample;
+    }
+
+    // RingBuffer
+
+    SOUNDIOPP_HOT int RingBuffer::capacity()
+    {
+        return soundio_ring_buffer_capacity(m_ringbuffer);
+    }
+
+    SOUNDIOPP_HOT char* RingBuffer::write_ptr()
+    {
+        return soundio_ring_buffer_write_ptr(m_ringbuffer);
+    }
+
+    SOUNDIOPP_HOT void RingBuffer::advance_write_ptr(int count)
+    {
+        soundio_ring_buffer_advance_write_ptr(m_ringbuffer, count);
+    }
+
+    SOUNDIOPP_HOT char* RingBuffer::read_ptr()
+    {
+        return soundio_ring_buffer_read_ptr(m_ringbuffer);
+    }
+
+    SOUNDIOPP_HOT void RingBuffer::advance_read_ptr(int count)
+    {
+        soundio_ring_buffer_advance_read_ptr(m_ringbuffer, count);
+    }
+
+    SOUNDIOPP_HOT int RingBuffer::fill_count()
+    {
+        return soundio_ring_buffer_fill_count(m_ringbuffer);
+    }
+
+    SOUNDIOPP_HOT int RingBuffer::free_count()
+    {
+        return soundio_ring_buffer_free_count(m_ringbuffer);
+    }
+}
+
+#undef SOUNDIOPP_HOT
+
+#endif // SOUNDIOPP_HOTPATH_H
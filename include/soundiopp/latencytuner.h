@@ -0,0 +1,76 @@
+#ifndef SOUNDIOPP_LATENCYTUNER_H
+#define SOUNDIOPP_LATENCYTUNER_H
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "soundiopp.h"
+
+namespace sio
+{
+    enum class TuneReason {
+        Underflow,
+        Headroom
+    };
+
+    struct LatencyDecision
+    {
+        double time;
+        double old_latency;
+        double new_latency;
+        TuneReason reason;
+        int underflow_count;
+        double min_margin;
+    };
+
+    // Picks the lowest software latency that runs without underflows.
+    // attach() chains onto the callbacks already set on the stream, so call
+    // it after set_write_callback/set_underflow_callback. update() runs on
+    // the control thread; when it returns true the stream has to be
+    // recreated and passed to apply() before open().
+    class LatencyTuner
+    {
+    public:
+        LatencyTuner();
+        void attach(OutStream* outstream);
+        bool update();
+        void apply(OutStream* outstream);
+        void reset();
+
+        double get_software_latency() const;
+        void set_software_latency(double software_latency);
+        double get_latency_min() const;
+        double get_latency_max() const;
+        void set_latency_range(double latency_min, double latency_max);
+        double get_increase_factor() const;
+        void set_increase_factor(double factor);
+        double get_decrease_factor() const;
+        void set_decrease_factor(double factor);
+        int get_stable_updates() const;
+        void set_stable_updates(int updates);
+        double get_margin_threshold() const;
+        void set_margin_threshold(double threshold);
+        std::vector<LatencyDecision> get_history() const;
+    private:
+        void record_margin(OutStream* outstream, int frame_count_max);
+        void add_decision(double new_latency, TuneReason reason,
+            int underflow_count, double min_margin);
+
+        std::atomic<int> m_underflow_count;
+        std::atomic<int> m_min_margin_frames;
+        std::atomic<int> m_sample_rate;
+        std::chrono::steady_clock::time_point m_start_time;
+        double m_latency;
+        double m_latency_min;
+        double m_latency_max;
+        double m_unsafe_latency;
+        double m_increase_factor;
+        double m_decrease_factor;
+        int m_stable_updates;
+        int m_clean_updates;
+        double m_margin_threshold;
+        std::vector<LatencyDecision> m_history;
+    };
+}
+
+#endif // SOUNDIOPP_LATENCYTUNER_H
@@ -0,0 +1,221 @@
+#ifndef SOUNDIOPP_LOCKFREE_H
+#define SOUNDIOPP_LOCKFREE_H
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace sio
+{
+    // Single writer, many readers. The writer never waits, readers retry
+    // while a store is in progress. T has to be trivially copyable.
+    template<typename T>
+    class SeqLock
+    {
+    public:
+        SeqLock();
+        void store(const T& value);
+        T load() const;
+    private:
+        std::atomic<unsigned> m_sequence;
+        T m_value;
+    };
+
+    // Bounded single producer, single consumer queue. Capacity is rounded
+    // up to a power of two and allocated once up front.
+    template<typename T>
+    class SpscRing
+    {
+    public:
+        explicit SpscRing(int capacity);
+        int write(const T* items, int count);
+        int read(T* items, int count);
+        int read_available() const;
+        int write_available() const;
+        int capacity() const;
+    private:
+        std::vector<T> m_buffer;
+        unsigned m_mask;
+        std::atomic<unsigned> m_write_index;
+        std::atomic<unsigned> m_read_index;
+    };
+
+    // Bounded multi producer, single consumer queue. Producers never block,
+    // push() fails when the queue is full.
+    template<typename T>
+    class MpscQueue
+    {
+    public:
+        explicit MpscQueue(int capacity);
+        bool push(const T& item);
+        bool pop(T& item);
+        int capacity() const;
+    private:
+        struct Cell
+        {
+            std::atomic<unsigned> sequence;
+            T item;
+        };
+
+        std::unique_ptr<Cell[]> m_cells;
+        unsigned m_mask;
+        std::atomic<unsigned> m_push_index;
+        unsigned m_pop_index;
+    };
+
+    template<typename T>
+    SeqLock<T>::SeqLock() : m_sequence(0), m_value()
+    {
+    }
+
+    template<typename T>
+    void SeqLock<T>::store(const T& value)
+    {
+        unsigned sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&m_value, &value, sizeof(T));
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    template<typename T>
+    T SeqLock<T>::load() const
+    {
+        T value;
+        unsigned before;
+        unsigned after;
+        do {
+            before = m_sequence.load(std::memory_order_acquire);
+            std::memcpy(&value, &m_value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+        return value;
+    }
+
+    template<typename T>
+    SpscRing<T>::SpscRing(int capacity) : m_write_index(0), m_read_index(0)
+    {
+        unsigned size = 1;
+        while (size < static_cast<unsigned>(capacity)) {
+            size <<= 1;
+        }
+        m_buffer.resize(size);
+        m_mask = size - 1;
+    }
+
+    template<typename T>
+    int SpscRing<T>::write(const T* items, int count)
+    {
+        unsigned write_index = m_write_index.load(std::memory_order_relaxed);
+        unsigned read_index = m_read_index.load(std::memory_order_acquire);
+        int available = static_cast<int>(
+            m_buffer.size() - (write_index - read_index));
+        if (count > available) {
+            count = available;
+        }
+        for (int i = 0; i < count; i++) {
+            m_buffer[(write_index + i) & m_mask] = items[i];
+        }
+        m_write_index.store(write_index + count, std::memory_order_release);
+        return count;
+    }
+
+    template<typename T>
+    int SpscRing<T>::read(T* items, int count)
+    {
+        unsigned read_index = m_read_index.load(std::memory_order_relaxed);
+        unsigned write_index = m_write_index.load(std::memory_order_acquire);
+        int available = static_cast<int>(write_index - read_index);
+        if (count > available) {
+            count = available;
+        }
+        for (int i = 0; i < count; i++) {
+            items[i] = m_buffer[(read_index + i) & m_mask];
+        }
+        m_read_index.store(read_index + count, std::memory_order_release);
+        return count;
+    }
+
+    template<typename T>
+    int SpscRing<T>::read_available() const
+    {
+        return static_cast<int>(m_write_index.load(std::memory_order_acquire)
+            - m_read_index.load(std::memory_order_relaxed));
+    }
+
+    template<typename T>
+    int SpscRing<T>::write_available() const
+    {
+        return static_cast<int>(m_buffer.size()
+            - (m_write_index.load(std::memory_order_relaxed)
+                - m_read_index.load(std::memory_order_acquire)));
+    }
+
+    template<typename T>
+    int SpscRing<T>::capacity() const
+    {
+        return static_cast<int>(m_buffer.size());
+    }
+
+    template<typename T>
+    MpscQueue<T>::MpscQueue(int capacity) : m_push_index(0), m_pop_index(0)
+    {
+        unsigned size = 1;
+        while (size < static_cast<unsigned>(capacity)) {
+            size <<= 1;
+        }
+        m_cells.reset(new Cell[size]);
+        for (unsigned i = 0; i < size; i++) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_mask = size - 1;
+    }
+
+    template<typename T>
+    bool MpscQueue<T>::push(const T& item)
+    {
+        unsigned index = m_push_index.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &m_cells[index & m_mask];
+            unsigned sequence = cell->sequence.load(std::memory_order_acquire);
+            int diff = static_cast<int>(sequence - index);
+            if (diff == 0) {
+                if (m_push_index.compare_exchange_weak(
+                        index, index + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                index = m_push_index.load(std::memory_order_relaxed);
+            }
+        }
+        cell->item = item;
+        cell->sequence.store(index + 1, std::memory_order_release);
+        return true;
+    }
+
+    template<typename T>
+    bool MpscQueue<T>::pop(T& item)
+    {
+        Cell* cell = &m_cells[m_pop_index & m_mask];
+        unsigned sequence = cell->sequence.load(std::memory_order_acquire);
+        if (static_cast<int>(sequence - (m_pop_index + 1)) < 0) {
+            return false;
+        }
+        item = cell->item;
+        cell->sequence.store(m_pop_index + m_mask + 1, std::memory_order_release);
+        m_pop_index++;
+        return true;
+    }
+
+    template<typename T>
+    int MpscQueue<T>::capacity() const
+    {
+        return static_cast<int>(m_mask + 1);
+    }
+}
+
+#endif // SOUNDIOPP_LOCKFREE_H
@@ -0,0 +1,54 @@
+#ifndef SOUNDIOPP_METER_H
+#define SOUNDIOPP_METER_H
+#include <atomic>
+#include <vector>
+
+#include "soundiopp.h"
+#include "lockfree.h"
+
+namespace sio
+{
+    struct ChannelLevel
+    {
+        float peak;
+        float rms;
+        unsigned clip_count;
+    };
+
+    // Per-channel peak, RMS and clip counter. The audio thread feeds it
+    // through OutStream::set_meter/InStream::set_meter, a UI thread polls
+    // read() without ever blocking the audio thread. The window and clip
+    // level may be changed from any thread while streaming.
+    class Meter
+    {
+    public:
+        Meter();
+        void process(FormatId format, const ChannelArea* areas,
+            int channel_count, int frame_count);
+        std::vector<ChannelLevel> read() const;
+        int read(ChannelLevel* levels, int level_count) const;
+
+        int get_window_frames() const;
+        void set_window_frames(int window_frames);
+        float get_clip_level() const;
+        void set_clip_level(float clip_level);
+    private:
+        struct Reading
+        {
+            int channel_count;
+            ChannelLevel channels[SOUNDIO_MAX_CHANNELS];
+        };
+
+        void publish(int channel_count);
+
+        SeqLock<Reading> m_reading;
+        float m_peak[SOUNDIO_MAX_CHANNELS];
+        double m_square_sum[SOUNDIO_MAX_CHANNELS];
+        unsigned m_clip_count[SOUNDIO_MAX_CHANNELS];
+        int m_frames;
+        std::atomic<int> m_window_frames;
+        std::atomic<float> m_clip_level;
+    };
+}
+
+#endif // SOUNDIOPP_METER_H
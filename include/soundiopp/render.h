@@ -0,0 +1,48 @@
+#ifndef SOUNDIOPP_RENDER_H
+#define SOUNDIOPP_RENDER_H
+#include <string>
+#include <vector>
+
+#include "soundiopp.h"
+
+namespace sio
+{
+    // Runs an OutStream without a device, calling its write callback back
+    // to back and collecting the interleaved output in memory
+    class RenderStream : public Driver
+    {
+    public:
+        RenderStream();
+        OutStream create_outstream();
+        int render(int frame_count);
+        void clear_output();
+        void save_wav(const std::string& path) const;
+
+        const std::vector<char>& get_output() const;
+        long long get_frames_rendered() const;
+        double get_realtime_factor() const;
+        int get_callback_frames_min() const;
+        int get_callback_frames_max() const;
+        void set_callback_frames(int frame_count_min, int frame_count_max);
+
+        using Driver::open;
+        using Driver::close;
+        virtual void open(OutStream* outstream);
+        virtual void close(OutStream* outstream);
+        virtual ErrorId begin_write(OutStream* outstream,
+            ChannelArea*& areas, int& frame_count) noexcept;
+        virtual ErrorId end_write(OutStream* outstream) noexcept;
+    private:
+        SoundIoOutStream* m_stream;
+        std::vector<char> m_output;
+        std::vector<ChannelArea> m_areas;
+        int m_callback_frames_min;
+        int m_callback_frames_max;
+        int m_budget;
+        int m_write_frames;
+        long long m_frames_rendered;
+        double m_render_seconds;
+    };
+}
+
+#endif // SOUNDIOPP_RENDER_H
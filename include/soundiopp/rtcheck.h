@@ -0,0 +1,35 @@
+#ifndef SOUNDIOPP_RTCHECK_H
+#define SOUNDIOPP_RTCHECK_H
+
+namespace sio
+{
+    // Marks the current thread as real-time while in scope. The stream
+    // callback wrappers open one around every write and read callback.
+    class RtScope
+    {
+    public:
+        RtScope();
+        ~RtScope();
+        RtScope(const RtScope&) = delete;
+        RtScope& operator=(const RtScope&) = delete;
+    private:
+        bool m_previous;
+    };
+
+    // Real-time safety checking. When the library is built with the
+    // SOUNDIOPP_RT_CHECK option, malloc and friends, mutex and condition
+    // variable waits and sleeps called on a thread inside an RtScope are
+    // reported to stderr with a backtrace. Setting SOUNDIOPP_RT_ABORT=1 in
+    // the environment aborts on the first violation instead. Linux only.
+    class RtCheck
+    {
+    public:
+        static bool is_enabled();
+        static bool is_realtime_thread();
+        static unsigned long long get_violation_count();
+        static bool get_abort_on_violation();
+        static void set_abort_on_violation(bool abort_on_violation);
+    };
+}
+
+#endif // SOUNDIOPP_RTCHECK_H
@@ -0,0 +1,120 @@
+#ifndef SOUNDIOPP_SAMPLECACHE_H
+#define SOUNDIOPP_SAMPLECACHE_H
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "soundiopp.h"
+#include "voice.h"
+
+namespace sio
+{
+    struct SampleFormat
+    {
+        FormatId format;
+        int channel_count;
+        int sample_rate;
+    };
+
+    class SampleCache;
+
+    // Reference to converted PCM owned by a SampleCache. Copying and
+    // destroying handles only touches an atomic counter, so they can be
+    // passed to and dropped on the audio thread. Memory is reclaimed by
+    // the cache once no handle refers to an entry anymore. All handles
+    // have to be gone before the cache is destroyed.
+    class SampleHandle
+    {
+    public:
+        SampleHandle();
+        SampleHandle(const SampleHandle& other);
+        SampleHandle(SampleHandle&& other);
+        SampleHandle& operator=(const SampleHandle& other);
+        SampleHandle& operator=(SampleHandle&& other);
+        ~SampleHandle();
+
+        bool is_valid() const;
+        bool is_ready() const;
+        bool is_failed() const;
+        // Interleaved frames in the target format, aligned to 64 bytes
+        const char* get_data() const;
+        int get_frame_count() const;
+        SampleFormat get_format() const;
+        // Only for Float32NE samples with one or two channels
+        VoiceSample get_voice_sample() const;
+    private:
+        friend class SampleCache;
+        struct Entry;
+
+        explicit SampleHandle(Entry* entry);
+
+        Entry* m_entry;
+    };
+
+    // Loads sources, converts them to the requested format and keeps the
+    // result for reuse. get() queues the load on the cache's worker thread
+    // and returns immediately, load() converts on the calling thread.
+    // Unreferenced entries are evicted least recently used first when the
+    // memory budget is exceeded. The default loader reads PCM and float
+    // WAV files from a path.
+    class SampleCache
+    {
+    public:
+        typedef std::function<bool(const std::string&, std::vector<char>&,
+            SampleFormat&)> Loader;
+
+        explicit SampleCache(size_t memory_budget = 64 * 1024 * 1024);
+        ~SampleCache();
+        SampleCache(const SampleCache&) = delete;
+        SampleCache& operator=(const SampleCache&) = delete;
+
+        SampleHandle get(const std::string& source,
+            const SampleFormat& target);
+        SampleHandle load(const std::string& source,
+            const SampleFormat& target);
+        void start();
+        void stop();
+        void evict();
+
+        Loader get_loader();
+        void set_loader(Loader loader);
+        size_t get_memory_budget() const;
+        void set_memory_budget(size_t memory_budget);
+        size_t get_memory_used() const;
+        unsigned long long get_hits() const;
+        unsigned long long get_misses() const;
+
+        static bool load_wav(const std::string& path, std::vector<char>& data,
+            SampleFormat& format);
+    private:
+        typedef SampleHandle::Entry Entry;
+
+        Entry* lookup(const std::string& source, const SampleFormat& target,
+            bool& created);
+        void convert(Entry* entry);
+        void run();
+
+        std::map<std::string, std::unique_ptr<Entry>> m_entries;
+        std::deque<Entry*> m_pending;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_condition;
+        Loader m_loader;
+        size_t m_memory_budget;
+        size_t m_memory_used;
+        unsigned long long m_tick;
+        std::atomic<unsigned long long> m_hits;
+        std::atomic<unsigned long long> m_misses;
+        bool m_running;
+        std::thread m_worker;
+    };
+}
+
+#endif // SOUNDIOPP_SAMPLECACHE_H
@@ -0,0 +1,52 @@
+#ifndef SOUNDIOPP_SCHEDULER_H
+#define SOUNDIOPP_SCHEDULER_H
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "soundiopp.h"
+#include "lockfree.h"
+
+namespace sio
+{
+    struct TimelineEvent
+    {
+        long long frame;
+        int type;
+        int id;
+        double value;
+        void* data;
+    };
+
+    // Frame accurate event timeline for one OutStream. schedule() may be
+    // called from any thread; process() runs inside the write callback for
+    // every chunk obtained from begin_write and splits it at event frames.
+    class Scheduler
+    {
+    public:
+        explicit Scheduler(int capacity = 1024);
+        bool schedule(const TimelineEvent& event);
+        void process(int frame_count);
+        void locate(long long frame);
+
+        long long get_position() const;
+        unsigned get_dropped_events() const;
+        std::function<void(int, int)> get_render_callback();
+        void set_render_callback(
+            std::function<void(int, int)> render_callback);
+        std::function<void(const TimelineEvent&, int)> get_event_callback();
+        void set_event_callback(
+            std::function<void(const TimelineEvent&, int)> event_callback);
+    private:
+        void drain();
+
+        MpscQueue<TimelineEvent> m_queue;
+        std::vector<TimelineEvent> m_pending;
+        std::atomic<long long> m_position;
+        std::atomic<unsigned> m_dropped_events;
+        std::function<void(int, int)> m_render_callback;
+        std::function<void(const TimelineEvent&, int)> m_event_callback;
+    };
+}
+
+#endif // SOUNDIOPP_SCHEDULER_H
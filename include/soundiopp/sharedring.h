@@ -0,0 +1,66 @@
+#ifndef SOUNDIOPP_SHAREDRING_H
+#define SOUNDIOPP_SHAREDRING_H
+#include <string>
+
+#include "soundiopp.h"
+
+namespace sio
+{
+    struct SharedRingHeader;
+
+    // Single producer, single consumer ring placed in a memfd so it can be
+    // shared between processes. The buffer is mapped twice back to back,
+    // so like RingBuffer a whole capacity is addressable from any pointer.
+    // Pass get_fd() to the peer with SCM_RIGHTS or /proc/<pid>/fd/<n>.
+    // Linux only.
+    class SharedRingBuffer
+    {
+    public:
+        SharedRingBuffer();
+        SharedRingBuffer(SharedRingBuffer&& other);
+        SharedRingBuffer& operator=(SharedRingBuffer&& other);
+        ~SharedRingBuffer();
+
+        static SharedRingBuffer create(int requested_capacity,
+            const std::string& name = "soundiopp");
+        static SharedRingBuffer attach(int fd);
+
+        int capacity();
+        char* write_ptr();
+        void advance_write_ptr(int count);
+        char* read_ptr();
+        void advance_read_ptr(int count);
+        int fill_count();
+        int free_count();
+        void clear();
+
+        // Block until at least count bytes are readable or writable.
+        // A negative timeout waits forever, returns false on timeout.
+        bool wait_fill(int count, int timeout_ms = -1);
+        bool wait_free(int count, int timeout_ms = -1);
+
+        // Take over the reader or writer side. Succeeds if the side is
+        // free or its previous owner has died, the ring state is kept so
+        // a restarted process continues where the old one stopped.
+        void claim_reader();
+        void claim_writer();
+        void release();
+
+        int get_fd() const;
+    private:
+        SharedRingBuffer(int fd, bool initialize, int capacity);
+        bool wait(bool fill, int count, int timeout_ms);
+        void claim(bool reader);
+
+        int m_fd;
+        int m_capacity;
+        int m_header_size;
+        char* m_mapping;
+        char* m_data;
+        SharedRingHeader* m_header;
+        bool m_reader;
+        bool m_writer;
+    };
+}
+
+#endif // SOUNDIOPP_SHAREDRING_H
@@ -26,6 +26,14 @@ namespace sio
     class OutStream;
     class InStream;
     class RingBuffer;
+    class Driver;
+    class Meter;
+    class AnalysisTap;
+    class StreamClock;
+    class Tracer;
+    class ThreadTuner;
+    class CallbackRecorder;
+    class WorkerPool;
 
     int get_bytes_per_sample(FormatId format);
     int get_bytes_per_frame(FormatId format, int channel_count);
@@ -48,6 +56,51 @@ namespace sio
         ErrorId m_error;
     };
 
+    // Cheap description of a device taken without constructing a Device,
+    // so devices that failed to probe show up too. Devices are matched by
+    // id, aim and rawness.
+    struct DeviceEntry
+    {
+        std::string id;
+        std::string name;
+        DeviceAimId aim;
+        bool is_raw;
+        // Current index for get_input_device/get_output_device, -1 once
+        // the device is gone
+        int index;
+        ErrorId probe_error;
+    };
+
+    struct DeviceDiff
+    {
+        std::vector<DeviceEntry> added;
+        std::vector<DeviceEntry> removed;
+        std::vector<DeviceEntry> changed;
+        bool default_input_changed;
+        bool default_output_changed;
+    };
+
+    struct BackendProbe
+    {
+        BackendId backend;
+        // None when the backend connected
+        ErrorId result;
+        // Still connecting when the backend was chosen
+        bool pending;
+        // Pending and the timeout had run out
+        bool timed_out;
+        // Time to connect, or until the choice for pending probes
+        double seconds;
+    };
+
+    struct ConnectReport
+    {
+        // None when no backend connected in time
+        BackendId chosen;
+        double seconds;
+        std::vector<BackendProbe> probes;
+    };
+
     class Context
     {
     public:
@@ -59,6 +112,7 @@ namespace sio
         operator SoundIo*() const;
         void connect();
         void connect_backend(SoundIoBackend backend);
+        ConnectReport connect_parallel(double timeout = 2.0);
         void disconnect();
         int default_input_device_index();
         int default_output_device_index();
@@ -70,6 +124,7 @@ namespace sio
         int output_device_count();
         Device get_input_device(int index);
         Device get_output_device(int index);
+        Device get_device(const DeviceEntry& entry);
         RingBuffer create_ring_buffer(int requested_capacity);
 
         void* get_userdata();
@@ -77,6 +132,7 @@ namespace sio
         BackendId get_current_backend() const;
         std::string get_app_name() const;
         void set_app_name(const std::string& name);
+        ConnectReport get_connect_report() const;
 
         std::function<void(Context*)> get_on_devices_change();
         void set_on_devices_change(
@@ -84,6 +140,11 @@ namespace sio
         std::function<void(Context*, ErrorId)> get_on_backend_disconnect();
         void set_on_backend_disconnect(
             std::function<void(Context*, ErrorId)> on_backend_disconnect);
+        std::function<void(Context*, const DeviceDiff&)> get_on_devices_diff();
+        void set_on_devices_diff(
+            std::function<void(Context*, const DeviceDiff&)> on_devices_diff);
+        double get_devices_debounce() const;
+        void set_devices_debounce(double seconds);
         std::function<void(Context*)> get_on_events_signal();
         void set_on_events_signal(
             std::function<void(Context*)> on_events_signal);
@@ -94,16 +155,45 @@ namespace sio
         void set_jack_info_callback(jack_callback_t jack_info_callback);
         jack_callback_t get_jack_error_callback();
         void set_jack_error_callback(jack_callback_t jack_error_callback);
+        Tracer* get_tracer();
+        void set_tracer(Tracer* tracer);
+        WorkerPool* get_worker_pool();
+        void set_worker_pool(WorkerPool* worker_pool);
     private:
         static void on_devices_change_wrapper(SoundIo* soundio);
         static void on_backend_disconnect_wrapper(SoundIo* soundio, int err);
         static void on_events_signal_wrapper(SoundIo* soundio);
 
+        struct DeviceSnapshot
+        {
+            DeviceEntry entry;
+            std::vector<std::string> layouts;
+            std::vector<int> formats;
+            std::vector<int> sample_rates;
+            int current_format;
+            int current_sample_rate;
+            double software_latency_min;
+            double software_latency_max;
+        };
+
+        std::vector<DeviceSnapshot> snapshot_devices();
+        void deliver_devices_diff();
+
         SoundIo* m_soundio;
         std::string m_app_name;
         void* m_userdata;
+        Tracer* m_tracer;
+        WorkerPool* m_worker_pool;
+        ConnectReport m_connect_report;
+        std::vector<DeviceSnapshot> m_devices;
+        std::string m_default_input;
+        std::string m_default_output;
+        bool m_devices_pending;
+        double m_devices_changed_at;
+        double m_devices_debounce;
 
         std::function<void(Context*)> m_on_devices_change;
+        std::function<void(Context*, const DeviceDiff&)> m_on_devices_diff;
         std::function<void(Context*, ErrorId)> m_on_backend_disconnect;
         std::function<void(Context*)> m_on_events_signal;
     };
@@ -194,6 +284,7 @@ namespace sio
     public:
         OutStream();
         OutStream(SoundIoOutStream* outstream, Device* device);
+        explicit OutStream(Driver* driver);
         OutStream(OutStream&& other);
         OutStream& operator=(OutStream&& other);
         ~OutStream();
@@ -203,11 +294,15 @@ namespace sio
         void start();
         int begin_write(ChannelArea*& areas, int frame_count);
         void end_write();
+        ErrorId try_begin_write(ChannelArea*& areas, int& frame_count)
+            noexcept;
+        ErrorId try_end_write() noexcept;
         void clear_buffer();
         void pause(bool paused);
         double get_latency();
 
         Device* get_device();
+        Driver* get_driver();
         FormatId get_format() const;
         void set_format(FormatId format);
         int get_sample_rate() const;
@@ -224,6 +319,18 @@ namespace sio
         void set_non_terminal_hint(bool hint);
         int get_bytes_per_frame() const;
         int get_bytes_per_sample() const;
+        Meter* get_meter();
+        void set_meter(Meter* meter);
+        AnalysisTap* get_tap();
+        void set_tap(AnalysisTap* tap);
+        StreamClock* get_clock();
+        void set_clock(StreamClock* clock);
+        Tracer* get_tracer();
+        void set_tracer(Tracer* tracer);
+        ThreadTuner* get_thread_tuner();
+        void set_thread_tuner(ThreadTuner* thread_tuner);
+        CallbackRecorder* get_recorder();
+        void set_recorder(CallbackRecorder* recorder);
 
         std::function<void(OutStream*, int, int)> get_write_callback();
         void set_write_callback(
@@ -244,6 +351,15 @@ namespace sio
 
         SoundIoOutStream* m_outstream;
         Device* m_device;
+        Driver* m_driver;
+        Meter* m_meter;
+        AnalysisTap* m_tap;
+        StreamClock* m_clock;
+        Tracer* m_tracer;
+        ThreadTuner* m_thread_tuner;
+        CallbackRecorder* m_recorder;
+        ChannelArea* m_write_areas;
+        int m_write_frames;
         void* m_userdata;
         std::string m_name;
         std::function<void(OutStream*, int, int)> m_write_callback;
@@ -256,6 +372,7 @@ namespace sio
     public:
         InStream();
         InStream(SoundIoInStream* instream, Device* device);
+        explicit InStream(Driver* driver);
         InStream(InStream&& other);
         InStream& operator=(InStream&& other);
         ~InStream();
@@ -265,10 +382,14 @@ namespace sio
         void start();
         int begin_read(ChannelArea*& areas, int frame_count);
         void end_read();
+        ErrorId try_begin_read(ChannelArea*& areas, int& frame_count)
+            noexcept;
+        ErrorId try_end_read() noexcept;
         void pause(bool paused);
         double get_latency();
 
         Device* get_device();
+        Driver* get_driver();
         FormatId get_format() const;
         void set_format(FormatId format);
         int get_sample_rate() const;
@@ -285,6 +406,18 @@ namespace sio
         void set_non_terminal_hint(bool hint);
         int get_bytes_per_frame() const;
         int get_bytes_per_sample() const;
+        Meter* get_meter();
+        void set_meter(Meter* meter);
+        AnalysisTap* get_tap();
+        void set_tap(AnalysisTap* tap);
+        StreamClock* get_clock();
+        void set_clock(StreamClock* clock);
+        Tracer* get_tracer();
+        void set_tracer(Tracer* tracer);
+        ThreadTuner* get_thread_tuner();
+        void set_thread_tuner(ThreadTuner* thread_tuner);
+        CallbackRecorder* get_recorder();
+        void set_recorder(CallbackRecorder* recorder);
 
         std::function<void(InStream*, int, int)> get_read_callback();
         void set_read_callback(
@@ -305,6 +438,14 @@ namespace sio
 
         SoundIoInStream* m_instream;
         Device* m_device;
+        Driver* m_driver;
+        Meter* m_meter;
+        AnalysisTap* m_tap;
+        StreamClock* m_clock;
+        Tracer* m_tracer;
+        ThreadTuner* m_thread_tuner;
+        CallbackRecorder* m_recorder;
+        int m_read_frames;
         void* m_userdata;
         std::string m_name;
         std::function<void(InStream*, int, int)> m_read_callback;
@@ -312,6 +453,40 @@ namespace sio
         std::function<void(InStream*, int)> m_error_callback;
     };
 
+    // Drives streams in place of a libsoundio backend. Callbacks are
+    // invoked through the stream's regular wrappers. The begin/end hooks run
+    // on the audio thread and report errors instead of throwing.
+    class Driver
+    {
+    public:
+        virtual ~Driver();
+        virtual void open(OutStream* outstream);
+        virtual void close(OutStream* outstream);
+        virtual void start(OutStream* outstream);
+        virtual void pause(OutStream* outstream, bool paused);
+        virtual void clear_buffer(OutStream* outstream);
+        virtual ErrorId begin_write(OutStream* outstream,
+            ChannelArea*& areas, int& frame_count) noexcept;
+        virtual ErrorId end_write(OutStream* outstream) noexcept;
+        virtual double get_latency(OutStream* outstream);
+
+        virtual void open(InStream* instream);
+        virtual void close(InStream* instream);
+        virtual void start(InStream* instream);
+        virtual void pause(InStream* instream, bool paused);
+        virtual ErrorId begin_read(InStream* instream,
+            ChannelArea*& areas, int& frame_count) noexcept;
+        virtual ErrorId end_read(InStream* instream) noexcept;
+        virtual double get_latency(InStream* instream);
+    protected:
+        static void write_callback(SoundIoOutStream* stream,
+            int frame_count_min, int frame_count_max);
+        static void underflow_callback(SoundIoOutStream* stream);
+        static void read_callback(SoundIoInStream* stream,
+            int frame_count_min, int frame_count_max);
+        static void overflow_callback(SoundIoInStream* stream);
+    };
+
     class RingBuffer
     {
     public:
@@ -333,4 +508,8 @@ namespace sio
     };
 }
 
+#ifdef SOUNDIOPP_INLINE
+#include "hotpath.h"
+#endif
+
 #endif // SOUNDIOPP_H
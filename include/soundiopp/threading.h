@@ -0,0 +1,98 @@
+#ifndef SOUNDIOPP_THREADING_H
+#define SOUNDIOPP_THREADING_H
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+#include "soundiopp.h"
+#include "lockfree.h"
+
+namespace sio
+{
+    enum class SchedPolicy {
+        Other,
+        Fifo,
+        RoundRobin
+    };
+
+    struct ThreadConfig
+    {
+        ThreadConfig();
+
+        // Other leaves the scheduling alone
+        SchedPolicy policy;
+        int priority;
+        // When the policy is refused, clamp the priority to RLIMIT_RTPRIO
+        // and finally try a negative nice value, like rtkit would
+        bool allow_fallback;
+        int fallback_nice;
+        // Bit n pins to CPU n, 0 leaves the affinity alone
+        unsigned long long cpu_mask;
+        // Stack bytes touched up front so the callback never faults on it
+        size_t stack_prefault;
+    };
+
+    // Outcome of applying a ThreadConfig. Errors are errno values, 0 on
+    // success. Page faults are counted since the config was applied and
+    // sampled once per fault interval of the ThreadTuner.
+    struct ThreadReport
+    {
+        bool applied;
+        int affinity_error;
+        int priority_error;
+        SchedPolicy policy;
+        int priority;
+        int nice;
+        bool fallback;
+        int cpu;
+        unsigned migrations;
+        long minor_faults;
+        long major_faults;
+    };
+
+    // Applies a ThreadConfig to whichever thread calls update() and keeps
+    // watching it for core migrations and page faults. Migrations are
+    // checked on every update(), faults only once per fault interval since
+    // reading them is a system call. Attach one to a
+    // stream with set_thread_tuner() and it tunes the backend's callback
+    // thread on the first callback. Reports may be read from any thread.
+    class ThreadTuner
+    {
+    public:
+        explicit ThreadTuner(const ThreadConfig& config = ThreadConfig());
+        void update();
+        ThreadReport get_report() const;
+
+        ThreadConfig get_config() const;
+        void set_config(const ThreadConfig& config);
+        // Seconds between page fault samples, 0 samples on every update()
+        double get_fault_interval() const;
+        void set_fault_interval(double fault_interval);
+
+        static ThreadReport apply(const ThreadConfig& config);
+        // mlockall of current and future pages, returns an errno value
+        static int lock_memory();
+        static int prefault(void* data, size_t size);
+        static void prefault_stack(size_t size);
+        // Applied by the library's own worker threads when they start
+        static ThreadConfig get_worker_config();
+        static void set_worker_config(const ThreadConfig& config);
+        static ThreadReport get_worker_report();
+        static void apply_worker();
+    private:
+        void publish();
+        void schedule_faults(std::chrono::steady_clock::time_point now);
+
+        SeqLock<ThreadConfig> m_config;
+        std::atomic<unsigned> m_config_version;
+        unsigned m_applied_version;
+        SeqLock<ThreadReport> m_report;
+        ThreadReport m_current;
+        long m_minor_base;
+        long m_major_base;
+        std::atomic<double> m_fault_interval;
+        std::chrono::steady_clock::time_point m_next_faults;
+    };
+}
+
+#endif // SOUNDIOPP_THREADING_H
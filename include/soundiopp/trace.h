@@ -0,0 +1,85 @@
+#ifndef SOUNDIOPP_TRACE_H
+#define SOUNDIOPP_TRACE_H
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "soundiopp.h"
+
+namespace sio
+{
+    struct TraceEvent
+    {
+        uint64_t time;
+        const char* name;
+        char phase;
+        long long value;
+    };
+
+    // Records spans, instants and counters into one ring per thread and
+    // exports them as Chrome trace JSON, which Perfetto opens as well.
+    // Rings come from a fixed pool on a thread's first event, stay with it
+    // and keep its most recent events_per_thread events. Recording never
+    // locks or allocates. Event names are stored by pointer and must outlive the
+    // tracer, string literals are the intended use.
+    class Tracer
+    {
+    public:
+        explicit Tracer(int events_per_thread = 16384, int max_threads = 32);
+        ~Tracer();
+        Tracer(const Tracer&) = delete;
+        Tracer& operator=(const Tracer&) = delete;
+
+        void begin(const char* name);
+        void end(const char* name);
+        void instant(const char* name);
+        void counter(const char* name, long long value);
+        void set_thread_name(const char* name);
+
+        void write_json(std::ostream& out) const;
+        void save_json(const std::string& path) const;
+        void clear();
+
+        bool get_enabled() const;
+        void set_enabled(bool enabled);
+        unsigned long long get_dropped_events() const;
+    private:
+        struct ThreadRing
+        {
+            // Process wide thread number, 0 while the ring is free
+            std::atomic<uint64_t> owner;
+            std::atomic<const char*> thread_name;
+            std::atomic<uint64_t> write_count;
+            std::unique_ptr<TraceEvent[]> events;
+        };
+
+        ThreadRing* ring();
+        void record(const char* name, char phase, long long value);
+
+        int m_events_per_thread;
+        int m_max_threads;
+        std::unique_ptr<ThreadRing[]> m_rings;
+        uint64_t m_start_time;
+        unsigned m_id;
+        std::atomic<bool> m_enabled;
+        std::atomic<unsigned long long> m_dropped_events;
+    };
+
+    // Begin and end event around a scope, does nothing without a tracer
+    class TraceScope
+    {
+    public:
+        TraceScope(Tracer* tracer, const char* name);
+        ~TraceScope();
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+    private:
+        Tracer* m_tracer;
+        const char* m_name;
+    };
+}
+
+#endif // SOUNDIOPP_TRACE_H
@@ -0,0 +1,164 @@
+#ifndef SOUNDIOPP_UDP_H
+#define SOUNDIOPP_UDP_H
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "soundiopp.h"
+#include "lockfree.h"
+
+namespace sio
+{
+    // Streams float32 audio between hosts over UDP. Linux only, packets
+    // carry host byte order and assume little endian peers.
+    class UdpSender
+    {
+    public:
+        UdpSender(const std::string& host, int port, int channel_count,
+            int packet_frames = 128);
+        ~UdpSender();
+        void attach(InStream* instream);
+        void process(FormatId format, const ChannelArea* areas,
+            int channel_count, int frame_count);
+        void start();
+        void stop();
+
+        unsigned long long get_packets_sent() const;
+        // Frames lost to a full queue, holes in the input and failed sends
+        unsigned get_dropped_frames() const;
+    private:
+        static const int batch_size = 16;
+        static const int send_retries = 5;
+
+        // Frames missing from the queue before the given queued frame
+        struct Gap
+        {
+            uint64_t position;
+            int frames;
+        };
+
+        void run();
+        void skip(int frame_count);
+
+        int m_socket;
+        std::vector<char> m_address;
+        int m_channel_count;
+        int m_packet_frames;
+        SpscRing<float> m_queue;
+        SpscRing<Gap> m_gaps;
+        // Audio thread
+        std::vector<float> m_convert;
+        std::vector<float> m_interleaved;
+        uint64_t m_queued_frames;
+        int m_gap_frames;
+        // Network thread
+        uint32_t m_sequence;
+        uint64_t m_frame;
+        uint64_t m_sent_frames;
+        Gap m_next_gap;
+        bool m_have_gap;
+        std::atomic<unsigned long long> m_packets_sent;
+        std::atomic<unsigned> m_dropped_frames;
+        std::atomic<bool> m_running;
+        std::thread m_worker;
+    };
+
+    struct UdpReceiverStats
+    {
+        unsigned long long packets_received;
+        unsigned long long packets_lost;
+        unsigned long long packets_late;
+        unsigned long long packets_overrun;
+        unsigned long long drift_corrections;
+        int buffered_packets;
+        int target_packets;
+        double jitter;
+        double transit_time;
+        double buffer_latency;
+    };
+
+    // Receives UdpSender packets into an adaptive jitter buffer. The
+    // network thread sizes the buffer from the measured arrival jitter, the
+    // audio thread conceals lost packets by fading out the last one and
+    // skips or repeats single frames to follow clock drift.
+    class UdpReceiver
+    {
+    public:
+        UdpReceiver(int port, int channel_count, int sample_rate,
+            int packet_frames = 128, int slot_count = 64);
+        ~UdpReceiver();
+        void attach(OutStream* outstream);
+        void read(float* interleaved, int frame_count);
+        void start();
+        void stop();
+
+        int get_port() const;
+        int get_min_packets() const;
+        void set_min_packets(int min_packets);
+        UdpReceiverStats get_stats() const;
+    private:
+        static const int batch_size = 16;
+
+        struct Slot
+        {
+            std::atomic<uint32_t> tag;
+            std::vector<float> samples;
+        };
+
+        void run();
+        void receive(const char* packet, int size, double arrival);
+        void next_packet();
+        void write(OutStream* outstream, int frame_count_min,
+            int frame_count_max);
+
+        int m_socket;
+        int m_port;
+        int m_channel_count;
+        int m_stream_channel_count;
+        int m_sample_rate;
+        int m_packet_frames;
+        int m_slot_count;
+        std::unique_ptr<Slot[]> m_slots;
+
+        // Network thread
+        bool m_have_transit;
+        double m_last_transit;
+        double m_transit_sum;
+        double m_jitter_estimate;
+        std::atomic<bool> m_have_first;
+        std::atomic<uint32_t> m_highest;
+        std::atomic<double> m_jitter;
+        std::atomic<double> m_transit_time;
+        std::atomic<int> m_target_packets;
+        std::atomic<int> m_min_packets;
+
+        // The audio thread asks for a resync, the network thread restarts
+        // from the next packet and hands the sequence back
+        std::atomic<bool> m_resync_requested;
+        std::atomic<bool> m_resync_ready;
+        std::atomic<uint32_t> m_resync_sequence;
+
+        // Audio thread
+        std::atomic<uint32_t> m_expected;
+        bool m_playing;
+        std::vector<float> m_current;
+        std::vector<float> m_interleaved;
+        int m_current_pos;
+        int m_current_end;
+        int m_losses;
+        double m_average_fill;
+
+        std::atomic<unsigned long long> m_packets_received;
+        std::atomic<unsigned long long> m_packets_lost;
+        std::atomic<unsigned long long> m_packets_late;
+        std::atomic<unsigned long long> m_packets_overrun;
+        std::atomic<unsigned long long> m_drift_corrections;
+        std::atomic<bool> m_running;
+        std::thread m_worker;
+    };
+}
+
+#endif // SOUNDIOPP_UDP_H
@@ -0,0 +1,101 @@
+#ifndef SOUNDIOPP_VIRTUALBACKEND_H
+#define SOUNDIOPP_VIRTUALBACKEND_H
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "soundiopp.h"
+
+namespace sio
+{
+    // Simulated device running on a virtual clock. Streams created here are
+    // only serviced from run(), which advances the clock and fires the
+    // callbacks in timestamp order, so every run is reproducible.
+    class VirtualBackend : public Driver
+    {
+    public:
+        VirtualBackend();
+        OutStream create_outstream();
+        InStream create_instream();
+        void run(double seconds);
+        void force_xrun();
+
+        double get_time() const;
+        double get_period() const;
+        void set_period(double period);
+        // Callback intervals vary uniformly by up to jitter either side of
+        // the period
+        double get_jitter() const;
+        void set_jitter(double jitter, uint32_t seed);
+        std::vector<double> get_intervals() const;
+        void set_intervals(const std::vector<double>& intervals);
+        std::vector<int> get_frame_counts() const;
+        void set_frame_counts(const std::vector<int>& frame_counts);
+        std::function<void(InStream*, ChannelArea*, int)>
+            get_capture_callback();
+        void set_capture_callback(
+            std::function<void(InStream*, ChannelArea*, int)>
+                capture_callback);
+
+        virtual void open(OutStream* outstream);
+        virtual void close(OutStream* outstream);
+        virtual void start(OutStream* outstream);
+        virtual void pause(OutStream* outstream, bool paused);
+        virtual void clear_buffer(OutStream* outstream);
+        virtual ErrorId begin_write(OutStream* outstream,
+            ChannelArea*& areas, int& frame_count) noexcept;
+        virtual ErrorId end_write(OutStream* outstream) noexcept;
+        virtual double get_latency(OutStream* outstream);
+
+        virtual void open(InStream* instream);
+        virtual void close(InStream* instream);
+        virtual void start(InStream* instream);
+        virtual void pause(InStream* instream, bool paused);
+        virtual ErrorId begin_read(InStream* instream,
+            ChannelArea*& areas, int& frame_count) noexcept;
+        virtual ErrorId end_read(InStream* instream) noexcept;
+        virtual double get_latency(InStream* instream);
+    private:
+        struct VirtualStream
+        {
+            SoundIoOutStream* outstream;
+            SoundIoInStream* instream;
+            int sample_rate;
+            int bytes_per_frame;
+            int capacity;
+            double fill;
+            double last_time;
+            double next_wakeup;
+            bool running;
+            bool xrun;
+            size_t callback_index;
+            int budget;
+            int pending;
+            std::vector<char> buffer;
+            std::vector<ChannelArea> areas;
+        };
+
+        VirtualStream* find(const void* stream);
+        // Non-throwing find for the noexcept hooks, nullptr when not open
+        VirtualStream* lookup(const void* stream) noexcept;
+        void add_stream(VirtualStream& stream, double software_latency,
+            int sample_rate, int bytes_per_frame, int bytes_per_sample,
+            int channel_count);
+        void remove_stream(const void* stream);
+        void service_output(size_t index);
+        void service_input(size_t index);
+        double next_interval(VirtualStream& stream);
+        int scripted_frame_count(VirtualStream& stream, int frame_count);
+
+        std::vector<VirtualStream> m_streams;
+        double m_time;
+        double m_period;
+        double m_jitter;
+        uint32_t m_random_state;
+        std::vector<double> m_intervals;
+        std::vector<int> m_frame_counts;
+        std::function<void(InStream*, ChannelArea*, int)> m_capture_callback;
+    };
+}
+
+#endif // SOUNDIOPP_VIRTUALBACKEND_H
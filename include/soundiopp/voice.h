@@ -0,0 +1,120 @@
+#ifndef SOUNDIOPP_VOICE_H
+#define SOUNDIOPP_VOICE_H
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "soundiopp.h"
+#include "lockfree.h"
+
+namespace sio
+{
+    typedef uint32_t VoiceId;
+
+    // Interleaved float PCM with one or two channels. The samples have to
+    // stay valid while a voice plays them.
+    struct VoiceSample
+    {
+        const float* samples;
+        int frame_count;
+        int channel_count;
+        int sample_rate;
+    };
+
+    struct VoiceParams
+    {
+        VoiceParams();
+
+        float gain;
+        // -1 is hard left, 1 hard right
+        float pan;
+        // Playback rate relative to the sample's own rate, must be above 0
+        float pitch;
+        int start_frame;
+        bool loop;
+        // When the pool is full the lowest priority, oldest voice is stolen
+        int priority;
+    };
+
+    // Mixes many one-shot or looping samples into a stereo output. Voices
+    // come from a fixed pool; play(), stop() and set_voice() may be called
+    // from any thread and reach the audio thread through a lock-free
+    // queue. Gain and pan changes are ramped over one block.
+    class VoiceEngine
+    {
+    public:
+        static const int max_block = 1024;
+
+        explicit VoiceEngine(int voice_count = 512, int sample_rate = 48000,
+            int command_capacity = 1024);
+        void attach(OutStream* outstream);
+        void render(float* left, float* right, int frame_count);
+
+        VoiceId play(const VoiceSample& sample,
+            const VoiceParams& params = VoiceParams());
+        void stop(VoiceId id);
+        void set_voice(VoiceId id, float gain, float pan, float pitch);
+        void stop_all();
+
+        int get_sample_rate() const;
+        void set_sample_rate(int sample_rate);
+        int get_active_voices() const;
+        unsigned get_stolen_voices() const;
+        unsigned get_dropped_commands() const;
+    private:
+        enum class CommandType {
+            Play,
+            Stop,
+            Update,
+            StopAll
+        };
+
+        struct Command
+        {
+            CommandType type;
+            VoiceId id;
+            VoiceSample sample;
+            VoiceParams params;
+        };
+
+        struct Voice
+        {
+            VoiceId id;
+            bool active;
+            bool stopping;
+            VoiceSample sample;
+            double position;
+            double step;
+            float pitch;
+            float gain;
+            float pan;
+            float left;
+            float right;
+            bool loop;
+            int priority;
+            unsigned long long age;
+        };
+
+        void write(OutStream* outstream, int frame_count_min,
+            int frame_count_max);
+        void push(const Command& command);
+        void drain();
+        void start(const Command& command);
+        Voice* find(VoiceId id);
+        void mix(Voice& voice, float* left, float* right, int frame_count);
+
+        MpscQueue<Command> m_queue;
+        std::vector<Voice> m_voices;
+        std::vector<float> m_left;
+        std::vector<float> m_right;
+        int m_sample_rate;
+        int m_channel_count;
+        unsigned long long m_started;
+        std::atomic<VoiceId> m_next_id;
+        std::atomic<int> m_active_voices;
+        std::atomic<unsigned> m_stolen_voices;
+        std::atomic<unsigned> m_dropped_commands;
+    };
+}
+
+#endif // SOUNDIOPP_VOICE_H
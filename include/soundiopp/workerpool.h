@@ -0,0 +1,107 @@
+#ifndef SOUNDIOPP_WORKERPOOL_H
+#define SOUNDIOPP_WORKERPOOL_H
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "soundiopp.h"
+#include "lockfree.h"
+
+namespace sio
+{
+    enum class WorkState {
+        Idle,
+        Queued,
+        Running,
+        Done,
+        // run threw
+        Failed
+    };
+
+    // A job prepared off the audio thread and submitted from it. The
+    // submitter owns it and polls get_state() to pick up the result, so it
+    // has to outlive the job. Once Done or Failed it may be submitted again.
+    class WorkItem
+    {
+    public:
+        explicit WorkItem(std::function<void()> run = nullptr);
+        WorkItem(const WorkItem&) = delete;
+        WorkItem& operator=(const WorkItem&) = delete;
+
+        WorkState get_state() const;
+        bool is_done() const;
+        std::function<void()> get_run();
+        void set_run(std::function<void()> run);
+    private:
+        friend class WorkerPool;
+
+        std::atomic<int> m_state;
+        std::function<void()> m_run;
+    };
+
+    // Threads for work that must not run in a stream callback, like disk
+    // reads, decoding, reallocation and freeing. submit() and retire() only
+    // push a pointer onto a preallocated queue, so they never lock or
+    // allocate and can be called from callbacks. They return false when the
+    // queue is full. Attach a pool to a Context with set_worker_pool() to
+    // make it reachable from every stream.
+    class WorkerPool
+    {
+    public:
+        explicit WorkerPool(int thread_count = 2, int queue_capacity = 1024);
+        ~WorkerPool();
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        void start();
+        void stop();
+        bool submit(WorkItem& item);
+        // Deletes the object on a worker. On false the caller still owns it.
+        template<typename T>
+        bool retire(T* object);
+        bool retire(void (*deleter)(void*), void* object);
+        int drain();
+
+        int get_thread_count() const;
+        double get_poll_interval() const;
+        void set_poll_interval(double poll_interval);
+        unsigned long long get_rejected() const;
+    private:
+        struct Task
+        {
+            WorkItem* item;
+            void (*deleter)(void*);
+            void* object;
+        };
+
+        template<typename T>
+        static void destroy(void* object);
+        bool run_one();
+        void run();
+
+        int m_thread_count;
+        MpscQueue<Task> m_queue;
+        // Serializes the queue's single consumer side between workers
+        std::mutex m_pop_mutex;
+        std::atomic<bool> m_running;
+        std::atomic<double> m_poll_interval;
+        std::atomic<unsigned long long> m_rejected;
+        std::vector<std::thread> m_workers;
+    };
+
+    template<typename T>
+    bool WorkerPool::retire(T* object)
+    {
+        return retire(&WorkerPool::destroy<T>, object);
+    }
+
+    template<typename T>
+    void WorkerPool::destroy(void* object)
+    {
+        delete static_cast<T*>(object);
+    }
+}
+
+#endif // SOUNDIOPP_WORKERPOOL_H
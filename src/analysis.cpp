@@ -0,0 +1,228 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/analysis.h"
+#include "soundiopp/threading.h"
+#include "convert.h"
+
+namespace sio
+{
+    static const double pi = 3.14159265358979323846;
+
+    SpectrumAnalyser::SpectrumAnalyser(int fft_size, int hop_size)
+        : m_fft(fft_size)
+    {
+        if (hop_size <= 0 || hop_size > fft_size) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        m_hop_size = hop_size;
+        m_window.resize(fft_size);
+        float window_sum = 0.0f;
+        for (int i = 0; i < fft_size; i++) {
+            m_window[i] = static_cast<float>(
+                0.5 - 0.5 * std::cos(2.0 * pi * i / fft_size));
+            window_sum += m_window[i];
+        }
+        // Full scale sine reads as 1.0
+        m_scale = 2.0f / window_sum;
+        m_history.assign(fft_size, 0.0f);
+        m_history_pos = 0;
+        m_history_fill = 0;
+        m_hop_count = 0;
+        m_frame.resize(fft_size);
+        m_bins.resize(fft_size / 2 + 1);
+        m_magnitudes.resize(fft_size / 2 + 1);
+        m_published.assign(fft_size / 2 + 1, 0.0f);
+        m_frame_index = 0;
+    }
+
+    void SpectrumAnalyser::push(const float* samples, int sample_count)
+    {
+        int fft_size = m_fft.get_size();
+        for (int i = 0; i < sample_count; i++) {
+            m_history[m_history_pos] = samples[i];
+            m_history_pos = (m_history_pos + 1) % fft_size;
+            if (m_history_fill < fft_size) {
+                m_history_fill++;
+            }
+            if (++m_hop_count >= m_hop_size && m_history_fill == fft_size) {
+                m_hop_count = 0;
+                analyse();
+            }
+        }
+    }
+
+    long long SpectrumAnalyser::read(std::vector<float>& magnitudes) const
+    {
+        std::lock_guard<std::mutex> lock(m_published_mutex);
+        magnitudes = m_published;
+        return m_frame_index;
+    }
+
+    // Getters/Setters
+
+    int SpectrumAnalyser::get_fft_size() const
+    {
+        return m_fft.get_size();
+    }
+
+    int SpectrumAnalyser::get_hop_size() const
+    {
+        return m_hop_size;
+    }
+
+    std::function<void(const float*, int)>
+        SpectrumAnalyser::get_frame_callback()
+    {
+        return m_frame_callback;
+    }
+
+    void SpectrumAnalyser::set_frame_callback(
+        std::function<void(const float*, int)> frame_callback)
+    {
+        m_frame_callback = frame_callback;
+    }
+
+    void SpectrumAnalyser::analyse()
+    {
+        int fft_size = m_fft.get_size();
+        // m_history_pos points at the oldest sample
+        for (int i = 0; i < fft_size; i++) {
+            m_frame[i] = m_history[(m_history_pos + i) % fft_size]
+                * m_window[i];
+        }
+        m_fft.forward(m_frame.data(), m_bins.data());
+        for (size_t k = 0; k < m_bins.size(); k++) {
+            m_magnitudes[k] = std::abs(m_bins[k]) * m_scale;
+        }
+
+        if (m_frame_callback) {
+            m_frame_callback(m_magnitudes.data(),
+                static_cast<int>(m_magnitudes.size()));
+        }
+        std::lock_guard<std::mutex> lock(m_published_mutex);
+        m_published = m_magnitudes;
+        m_frame_index++;
+    }
+
+    AnalysisTap::AnalysisTap(int capacity) : m_queue(capacity)
+    {
+        m_convert.resize(chunk_frames);
+        m_mix.resize(chunk_frames);
+        m_channel = -1;
+        m_dropped_frames = 0;
+        m_running = false;
+    }
+
+    AnalysisTap::~AnalysisTap()
+    {
+        stop();
+    }
+
+    void AnalysisTap::add_analyser(SpectrumAnalyser* analyser)
+    {
+        // The worker iterates the list without a lock
+        if (m_running) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        m_analysers.push_back(analyser);
+    }
+
+    void AnalysisTap::start()
+    {
+        if (m_running) {
+            return;
+        }
+        m_running = true;
+        m_worker = std::thread(&AnalysisTap::run, this);
+    }
+
+    void AnalysisTap::stop()
+    {
+        m_running = false;
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+    }
+
+    void AnalysisTap::process(FormatId format, const ChannelArea* areas,
+        int channel_count, int frame_count)
+    {
+        int channel = m_channel.load(std::memory_order_relaxed);
+        int first = channel < 0 ? 0 : channel;
+        int last = channel < 0 ? channel_count : channel + 1;
+        if (last > channel_count) {
+            return;
+        }
+        float gain = 1.0f / (last - first);
+
+        for (int offset = 0; offset < frame_count; offset += chunk_frames) {
+            int chunk = frame_count - offset;
+            if (chunk > chunk_frames) {
+                chunk = chunk_frames;
+            }
+            for (int i = 0; i < chunk; i++) {
+                m_mix[i] = 0.0f;
+            }
+            for (int ch = first; ch < last; ch++) {
+                ReadVisitor visitor = {
+                    areas[ch].ptr + offset * areas[ch].step, areas[ch].step,
+                    chunk, m_convert.data()
+                };
+                if (!visit_reader(static_cast<SoundIoFormat>(format), visitor)) {
+                    return;
+                }
+                for (int i = 0; i < chunk; i++) {
+                    m_mix[i] += m_convert[i] * gain;
+                }
+            }
+            int written = m_queue.write(m_mix.data(), chunk);
+            if (written < chunk) {
+                m_dropped_frames.fetch_add(
+                    chunk - written, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Getters/Setters
+
+    int AnalysisTap::get_channel() const
+    {
+        return m_channel.load(std::memory_order_relaxed);
+    }
+
+    void AnalysisTap::set_channel(int channel)
+    {
+        m_channel.store(channel, std::memory_order_relaxed);
+    }
+
+    unsigned AnalysisTap::get_dropped_frames() const
+    {
+        return m_dropped_frames.load();
+    }
+
+    void AnalysisTap::run()
+    {
+        ThreadTuner::apply_worker();
+        std::vector<float> samples(4096);
+        while (m_running) {
+            int count = m_queue.read(samples.data(),
+                static_cast<int>(samples.size()));
+            if (count == 0) {
+                // Polling keeps the audio thread free of wakeup syscalls
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                continue;
+            }
+            for (size_t i = 0; i < m_analysers.size(); i++) {
+                m_analysers[i]->push(samples.data(), count);
+            }
+        }
+    }
+}
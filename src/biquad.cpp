@@ -0,0 +1,358 @@
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/biquad.h"
+
+namespace sio
+{
+    static const double pi = 3.14159265358979323846;
+
+    static BiquadCoeffs normalize(double b0, double b1, double b2, double a0,
+        double a1, double a2)
+    {
+        BiquadCoeffs coeffs;
+        coeffs.b0 = static_cast<float>(b0 / a0);
+        coeffs.b1 = static_cast<float>(b1 / a0);
+        coeffs.b2 = static_cast<float>(b2 / a0);
+        coeffs.a1 = static_cast<float>(a1 / a0);
+        coeffs.a2 = static_cast<float>(a2 / a0);
+        return coeffs;
+    }
+
+    BiquadCoeffs BiquadCoeffs::identity()
+    {
+        return normalize(1.0, 0.0, 0.0, 1.0, 0.0, 0.0);
+    }
+
+    BiquadCoeffs BiquadCoeffs::lowpass(double frequency, double q,
+        double sample_rate)
+    {
+        double w0 = 2.0 * pi * frequency / sample_rate;
+        double cosine = std::cos(w0);
+        double alpha = std::sin(w0) / (2.0 * q);
+        return normalize((1.0 - cosine) / 2.0, 1.0 - cosine,
+            (1.0 - cosine) / 2.0, 1.0 + alpha, -2.0 * cosine, 1.0 - alpha);
+    }
+
+    BiquadCoeffs BiquadCoeffs::highpass(double frequency, double q,
+        double sample_rate)
+    {
+        double w0 = 2.0 * pi * frequency / sample_rate;
+        double cosine = std::cos(w0);
+        double alpha = std::sin(w0) / (2.0 * q);
+        return normalize((1.0 + cosine) / 2.0, -(1.0 + cosine),
+            (1.0 + cosine) / 2.0, 1.0 + alpha, -2.0 * cosine, 1.0 - alpha);
+    }
+
+    BiquadCoeffs BiquadCoeffs::bandpass(double frequency, double q,
+        double sample_rate)
+    {
+        double w0 = 2.0 * pi * frequency / sample_rate;
+        double alpha = std::sin(w0) / (2.0 * q);
+        return normalize(alpha, 0.0, -alpha, 1.0 + alpha,
+            -2.0 * std::cos(w0), 1.0 - alpha);
+    }
+
+    BiquadCoeffs BiquadCoeffs::notch(double frequency, double q,
+        double sample_rate)
+    {
+        double w0 = 2.0 * pi * frequency / sample_rate;
+        double cosine = std::cos(w0);
+        double alpha = std::sin(w0) / (2.0 * q);
+        return normalize(1.0, -2.0 * cosine, 1.0, 1.0 + alpha,
+            -2.0 * cosine, 1.0 - alpha);
+    }
+
+    BiquadCoeffs BiquadCoeffs::peaking(double frequency, double q,
+        double gain_db, double sample_rate)
+    {
+        double w0 = 2.0 * pi * frequency / sample_rate;
+        double cosine = std::cos(w0);
+        double alpha = std::sin(w0) / (2.0 * q);
+        double amplitude = std::pow(10.0, gain_db / 40.0);
+        return normalize(1.0 + alpha * amplitude, -2.0 * cosine,
+            1.0 - alpha * amplitude, 1.0 + alpha / amplitude, -2.0 * cosine,
+            1.0 - alpha / amplitude);
+    }
+
+    BiquadCoeffs BiquadCoeffs::low_shelf(double frequency, double q,
+        double gain_db, double sample_rate)
+    {
+        double w0 = 2.0 * pi * frequency / sample_rate;
+        double cosine = std::cos(w0);
+        double alpha = std::sin(w0) / (2.0 * q);
+        double a = std::pow(10.0, gain_db / 40.0);
+        double shelf = 2.0 * std::sqrt(a) * alpha;
+        return normalize(
+            a * ((a + 1.0) - (a - 1.0) * cosine + shelf),
+            2.0 * a * ((a - 1.0) - (a + 1.0) * cosine),
+            a * ((a + 1.0) - (a - 1.0) * cosine - shelf),
+            (a + 1.0) + (a - 1.0) * cosine + shelf,
+            -2.0 * ((a - 1.0) + (a + 1.0) * cosine),
+            (a + 1.0) + (a - 1.0) * cosine - shelf);
+    }
+
+    BiquadCoeffs BiquadCoeffs::high_shelf(double frequency, double q,
+        double gain_db, double sample_rate)
+    {
+        double w0 = 2.0 * pi * frequency / sample_rate;
+        double cosine = std::cos(w0);
+        double alpha = std::sin(w0) / (2.0 * q);
+        double a = std::pow(10.0, gain_db / 40.0);
+        double shelf = 2.0 * std::sqrt(a) * alpha;
+        return normalize(
+            a * ((a + 1.0) + (a - 1.0) * cosine + shelf),
+            -2.0 * a * ((a - 1.0) + (a + 1.0) * cosine),
+            a * ((a + 1.0) + (a - 1.0) * cosine - shelf),
+            (a + 1.0) - (a - 1.0) * cosine + shelf,
+            2.0 * ((a - 1.0) - (a + 1.0) * cosine),
+            (a + 1.0) - (a - 1.0) * cosine - shelf);
+    }
+
+    BiquadBank::BiquadBank(int channel_count, int stage_count,
+        int ramp_frames)
+    {
+        if (channel_count < 1 || stage_count < 1 || ramp_frames < 0) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        static_assert(sizeof(Lanes) == 5 * lane_width * sizeof(float),
+            "Lanes is walked as a flat float array");
+        m_channel_count = channel_count;
+        m_stage_count = stage_count;
+        m_group_count = (channel_count + lane_width - 1) / lane_width;
+        m_ramp_frames = ramp_frames;
+
+        BiquadCoeffs identity = BiquadCoeffs::identity();
+        Lanes lanes;
+        for (int l = 0; l < lane_width; l++) {
+            lanes.b0[l] = identity.b0;
+            lanes.b1[l] = identity.b1;
+            lanes.b2[l] = identity.b2;
+            lanes.a1[l] = identity.a1;
+            lanes.a2[l] = identity.a2;
+        }
+        m_current.assign(m_group_count * stage_count, lanes);
+        m_target = m_current;
+        m_delta.resize(m_current.size());
+        m_state.resize(m_current.size());
+        m_block.resize(ramp_block * lane_width);
+        m_planar_areas.resize(channel_count);
+        m_pending.reset(new SeqLock<BiquadCoeffs>[channel_count * stage_count]);
+        for (int i = 0; i < channel_count * stage_count; i++) {
+            m_pending[i].store(identity);
+        }
+        m_version = 0;
+        m_version_seen = 0;
+        reset();
+    }
+
+    void BiquadBank::set_stage(int channel, int stage,
+        const BiquadCoeffs& coeffs)
+    {
+        if (channel < 0 || channel >= m_channel_count || stage < 0 ||
+                stage >= m_stage_count) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        std::lock_guard<std::mutex> lock(m_control_mutex);
+        m_pending[channel * m_stage_count + stage].store(coeffs);
+        m_version.fetch_add(1, std::memory_order_release);
+    }
+
+    void BiquadBank::process(float* const* channels, int frame_count)
+    {
+        for (int ch = 0; ch < m_channel_count; ch++) {
+            m_planar_areas[ch].ptr = reinterpret_cast<char*>(channels[ch]);
+            m_planar_areas[ch].step = sizeof(float);
+        }
+        process_areas<float>(m_planar_areas.data(), frame_count);
+    }
+
+    bool BiquadBank::process(FormatId format, const ChannelArea* areas,
+        int channel_count, int frame_count)
+    {
+        if (channel_count != m_channel_count) {
+            return false;
+        }
+        SoundIoFormat soundio_format = static_cast<SoundIoFormat>(format);
+        if (soundio_format == SoundIoFormatFloat32NE) {
+            process_areas<float>(areas, frame_count);
+        } else if (soundio_format == SoundIoFormatFloat64NE) {
+            process_areas<double>(areas, frame_count);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    void BiquadBank::reset()
+    {
+        std::memset(m_state.data(), 0, m_state.size() * sizeof(State));
+        m_ramp_steps = 0;
+        m_block_pos = 0;
+    }
+
+    // Getters/Setters
+
+    int BiquadBank::get_channel_count() const
+    {
+        return m_channel_count;
+    }
+
+    int BiquadBank::get_stage_count() const
+    {
+        return m_stage_count;
+    }
+
+    int BiquadBank::get_ramp_frames() const
+    {
+        return m_ramp_frames;
+    }
+
+    template<typename Sample>
+    void BiquadBank::process_areas(const ChannelArea* areas, int frame_count)
+    {
+        update();
+        int offset = 0;
+        while (offset < frame_count) {
+            if (m_block_pos == 0) {
+                step_ramp();
+            }
+            int chunk = ramp_block - m_block_pos;
+            if (chunk > frame_count - offset) {
+                chunk = frame_count - offset;
+            }
+
+            for (int group = 0; group < m_group_count; group++) {
+                int first = group * lane_width;
+                int lanes = m_channel_count - first;
+                if (lanes > lane_width) {
+                    lanes = lane_width;
+                }
+                // Gather lane_width channels frame by frame, unused lanes
+                // stay silent
+                if (lanes < lane_width) {
+                    std::memset(m_block.data(), 0,
+                        m_block.size() * sizeof(float));
+                }
+                for (int l = 0; l < lanes; l++) {
+                    const ChannelArea& area = areas[first + l];
+                    const char* ptr = area.ptr + offset * area.step;
+                    for (int i = 0; i < chunk; i++) {
+                        Sample sample;
+                        std::memcpy(&sample, ptr + i * area.step,
+                            sizeof(Sample));
+                        m_block[i * lane_width + l] =
+                            static_cast<float>(sample);
+                    }
+                }
+
+                filter(group, m_block.data(), chunk);
+
+                for (int l = 0; l < lanes; l++) {
+                    const ChannelArea& area = areas[first + l];
+                    char* ptr = area.ptr + offset * area.step;
+                    for (int i = 0; i < chunk; i++) {
+                        Sample sample = static_cast<Sample>(
+                            m_block[i * lane_width + l]);
+                        std::memcpy(ptr + i * area.step, &sample,
+                            sizeof(Sample));
+                    }
+                }
+            }
+            offset += chunk;
+            m_block_pos = (m_block_pos + chunk) % ramp_block;
+        }
+    }
+
+    void BiquadBank::update()
+    {
+        unsigned version = m_version.load(std::memory_order_acquire);
+        if (version == m_version_seen) {
+            return;
+        }
+        m_version_seen = version;
+
+        for (int ch = 0; ch < m_channel_count; ch++) {
+            int group = ch / lane_width;
+            int lane = ch % lane_width;
+            for (int s = 0; s < m_stage_count; s++) {
+                BiquadCoeffs coeffs = m_pending[ch * m_stage_count + s].load();
+                Lanes& target = m_target[group * m_stage_count + s];
+                target.b0[lane] = coeffs.b0;
+                target.b1[lane] = coeffs.b1;
+                target.b2[lane] = coeffs.b2;
+                target.a1[lane] = coeffs.a1;
+                target.a2[lane] = coeffs.a2;
+            }
+        }
+
+        // Restart the ramp from wherever the coefficients are now
+        m_ramp_steps = m_ramp_frames / ramp_block;
+        if (m_ramp_steps == 0) {
+            m_current = m_target;
+            return;
+        }
+        for (size_t i = 0; i < m_current.size(); i++) {
+            const float* current = m_current[i].b0;
+            const float* target = m_target[i].b0;
+            float* delta = m_delta[i].b0;
+            for (int k = 0; k < 5 * lane_width; k++) {
+                delta[k] = (target[k] - current[k]) / m_ramp_steps;
+            }
+        }
+    }
+
+    void BiquadBank::step_ramp()
+    {
+        if (m_ramp_steps == 0) {
+            return;
+        }
+        m_ramp_steps--;
+        if (m_ramp_steps == 0) {
+            m_current = m_target;
+            return;
+        }
+        // Linear steps between two stable sections stay stable, the
+        // stability triangle is convex
+        for (size_t i = 0; i < m_current.size(); i++) {
+            float* current = m_current[i].b0;
+            const float* delta = m_delta[i].b0;
+            for (int k = 0; k < 5 * lane_width; k++) {
+                current[k] += delta[k];
+            }
+        }
+    }
+
+    void BiquadBank::filter(int group, float* block, int frame_count)
+    {
+        for (int s = 0; s < m_stage_count; s++) {
+            const Lanes& c = m_current[group * m_stage_count + s];
+            State& state = m_state[group * m_stage_count + s];
+            float z1[lane_width];
+            float z2[lane_width];
+            std::memcpy(z1, state.z1, sizeof(z1));
+            std::memcpy(z2, state.z2, sizeof(z2));
+
+            for (int i = 0; i < frame_count; i++) {
+                float* x = block + i * lane_width;
+                for (int l = 0; l < lane_width; l++) {
+                    float in = x[l];
+                    float out = c.b0[l] * in + z1[l];
+                    z1[l] = c.b1[l] * in - c.a1[l] * out + z2[l];
+                    z2[l] = c.b2[l] * in - c.a2[l] * out;
+                    x[l] = out;
+                }
+            }
+
+            // Decaying state would turn denormal and stall the FPU
+            for (int l = 0; l < lane_width; l++) {
+                state.z1[l] = std::fabs(z1[l]) < 1e-20f ? 0.0f : z1[l];
+                state.z2[l] = std::fabs(z2[l]) < 1e-20f ? 0.0f : z2[l];
+            }
+        }
+    }
+}
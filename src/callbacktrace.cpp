@@ -0,0 +1,539 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/callbacktrace.h"
+
+namespace sio
+{
+    static const char trace_magic[7] = {'S', 'I', 'O', 'C', 'B', 'T', 1};
+
+    static uint64_t trace_time()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static void put_varint(std::ostream& out, uint64_t value)
+    {
+        while (value >= 0x80) {
+            out.put(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.put(static_cast<char>(value));
+    }
+
+    static bool get_varint(std::istream& in, uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int byte = in.get();
+            if (byte == std::char_traits<char>::eof()) {
+                return false;
+            }
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static int get_int(std::istream& in)
+    {
+        uint64_t value;
+        if (!get_varint(in, value) || value > 0x7fffffff) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        return static_cast<int>(value);
+    }
+
+    CallbackTrace::CallbackTrace()
+    {
+        aim = DeviceAimId::Output;
+        format = FormatId::Invalid;
+        sample_rate = 0;
+        dropped_events = 0;
+    }
+
+    void CallbackTrace::save(const std::string& path) const
+    {
+        std::ofstream file(path.c_str(), std::ios::binary);
+        if (!file) {
+            throw soundio_error(ErrorId::OpeningDevice);
+        }
+        file.write(trace_magic, sizeof(trace_magic));
+        put_varint(file, static_cast<uint64_t>(aim));
+        put_varint(file, static_cast<uint64_t>(format));
+        put_varint(file, sample_rate);
+        put_varint(file, channels.size());
+        for (size_t i = 0; i < channels.size(); i++) {
+            put_varint(file, static_cast<uint64_t>(channels[i]));
+        }
+        put_varint(file, dropped_events);
+        put_varint(file, events.size());
+
+        // Times are stored as deltas, granted frames carry no time
+        uint64_t last_time = 0;
+        for (size_t i = 0; i < events.size(); i++) {
+            const CallbackEvent& event = events[i];
+            file.put(static_cast<char>(event.type));
+            if (event.type == CallbackEventType::Frames) {
+                put_varint(file, event.frame_count_max);
+                continue;
+            }
+            uint64_t time = event.time > last_time ? event.time : last_time;
+            put_varint(file, time - last_time);
+            last_time = time;
+            if (event.type == CallbackEventType::Callback) {
+                put_varint(file, event.frame_count_min);
+                put_varint(file, event.frame_count_max);
+            }
+        }
+        if (!file) {
+            throw soundio_error(ErrorId::Streaming);
+        }
+    }
+
+    void CallbackTrace::load(const std::string& path)
+    {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        if (!file) {
+            throw soundio_error(ErrorId::OpeningDevice);
+        }
+        char magic[sizeof(trace_magic)];
+        if (!file.read(magic, sizeof(magic)) ||
+                std::memcmp(magic, trace_magic, sizeof(magic)) != 0) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+
+        CallbackTrace trace;
+        trace.aim = static_cast<DeviceAimId>(get_int(file));
+        trace.format = static_cast<FormatId>(get_int(file));
+        trace.sample_rate = get_int(file);
+        int channel_count = get_int(file);
+        if (channel_count > SOUNDIO_MAX_CHANNELS) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        for (int i = 0; i < channel_count; i++) {
+            trace.channels.push_back(static_cast<ChannelId>(get_int(file)));
+        }
+        uint64_t dropped_events;
+        if (!get_varint(file, dropped_events)) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        trace.dropped_events = dropped_events;
+        int event_count = get_int(file);
+
+        uint64_t time = 0;
+        for (int i = 0; i < event_count; i++) {
+            CallbackEvent event = CallbackEvent();
+            int type = file.get();
+            if (type < 0 || type > static_cast<int>(CallbackEventType::Xrun)) {
+                throw soundio_error(ErrorId::Invalid);
+            }
+            event.type = static_cast<CallbackEventType>(type);
+            if (event.type == CallbackEventType::Frames) {
+                event.frame_count_max = get_int(file);
+                event.time = time;
+                trace.events.push_back(event);
+                continue;
+            }
+            uint64_t delta;
+            if (!get_varint(file, delta)) {
+                throw soundio_error(ErrorId::Invalid);
+            }
+            time += delta;
+            event.time = time;
+            if (event.type == CallbackEventType::Callback) {
+                event.frame_count_min = get_int(file);
+                event.frame_count_max = get_int(file);
+            }
+            trace.events.push_back(event);
+        }
+        *this = trace;
+    }
+
+    CallbackRecorder::CallbackRecorder(int max_events)
+    {
+        m_events.reset(new CallbackEvent[max_events]);
+        m_max_events = max_events;
+        m_event_count = 0;
+        m_dropped_events = 0;
+        m_started = false;
+        m_start_time = 0;
+        m_last_time = 0;
+        m_aim = DeviceAimId::Output;
+        m_format = FormatId::Invalid;
+        m_sample_rate = 0;
+        m_channel_count = 0;
+    }
+
+    void CallbackRecorder::callback(OutStream* outstream,
+        int frame_count_min, int frame_count_max)
+    {
+        uint64_t time = trace_time();
+        if (!m_started) {
+            const SoundIoOutStream* stream = *outstream;
+            start(DeviceAimId::Output, stream->layout, stream->format,
+                stream->sample_rate);
+            m_start_time = time;
+        }
+        m_last_time = time - m_start_time;
+        record(CallbackEventType::Callback, m_last_time,
+            frame_count_min, frame_count_max);
+    }
+
+    void CallbackRecorder::callback(InStream* instream,
+        int frame_count_min, int frame_count_max)
+    {
+        uint64_t time = trace_time();
+        if (!m_started) {
+            const SoundIoInStream* stream = *instream;
+            start(DeviceAimId::Input, stream->layout, stream->format,
+                stream->sample_rate);
+            m_start_time = time;
+        }
+        m_last_time = time - m_start_time;
+        record(CallbackEventType::Callback, m_last_time,
+            frame_count_min, frame_count_max);
+    }
+
+    void CallbackRecorder::frames(int frame_count)
+    {
+        if (m_started) {
+            record(CallbackEventType::Frames, m_last_time, 0, frame_count);
+        }
+    }
+
+    void CallbackRecorder::xrun()
+    {
+        if (m_started) {
+            record(CallbackEventType::Xrun, trace_time() - m_start_time, 0, 0);
+        }
+    }
+
+    void CallbackRecorder::clear()
+    {
+        m_event_count = 0;
+        m_dropped_events = 0;
+        m_started = false;
+    }
+
+    CallbackTrace CallbackRecorder::get_trace() const
+    {
+        CallbackTrace trace;
+        int count = m_event_count.load(std::memory_order_acquire);
+        if (count == 0) {
+            return trace;
+        }
+        trace.aim = m_aim;
+        trace.format = m_format;
+        trace.sample_rate = m_sample_rate;
+        trace.channels.assign(m_channels, m_channels + m_channel_count);
+        trace.dropped_events = m_dropped_events.load();
+        trace.events.assign(m_events.get(), m_events.get() + count);
+        return trace;
+    }
+
+    void CallbackRecorder::save(const std::string& path) const
+    {
+        get_trace().save(path);
+    }
+
+    // Getters/Setters
+
+    int CallbackRecorder::get_event_count() const
+    {
+        return m_event_count.load();
+    }
+
+    unsigned long long CallbackRecorder::get_dropped_events() const
+    {
+        return m_dropped_events.load();
+    }
+
+    void CallbackRecorder::start(DeviceAimId aim,
+        const SoundIoChannelLayout& layout, int format, int sample_rate)
+    {
+        m_aim = aim;
+        m_format = static_cast<FormatId>(format);
+        m_sample_rate = sample_rate;
+        m_channel_count = layout.channel_count;
+        for (int ch = 0; ch < m_channel_count; ch++) {
+            m_channels[ch] = static_cast<ChannelId>(layout.channels[ch]);
+        }
+        m_started = true;
+    }
+
+    void CallbackRecorder::record(CallbackEventType type, uint64_t time,
+        int frame_count_min, int frame_count_max)
+    {
+        // Only the stream's callback thread writes
+        int index = m_event_count.load(std::memory_order_relaxed);
+        if (index >= m_max_events) {
+            m_dropped_events.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        CallbackEvent& event = m_events[index];
+        event.type = type;
+        event.time = time;
+        event.frame_count_min = frame_count_min;
+        event.frame_count_max = frame_count_max;
+        m_event_count.store(index + 1, std::memory_order_release);
+    }
+
+    CallbackReplayer::CallbackReplayer()
+    {
+        m_outstream = nullptr;
+        m_instream = nullptr;
+        m_realtime = false;
+        m_position = 0;
+        m_budget = 0;
+        m_granted = 0;
+        m_max_frames = 0;
+    }
+
+    void CallbackReplayer::load(const std::string& path)
+    {
+        CallbackTrace trace;
+        trace.load(path);
+        set_trace(trace);
+    }
+
+    OutStream CallbackReplayer::create_outstream()
+    {
+        OutStream outstream(this);
+        outstream.set_format(m_trace.format);
+        outstream.set_sample_rate(m_trace.sample_rate);
+        ChannelLayout layout;
+        layout.set_channels(m_trace.channels);
+        layout.detect_builtin();
+        outstream.set_layout(layout);
+        return outstream;
+    }
+
+    InStream CallbackReplayer::create_instream()
+    {
+        InStream instream(this);
+        instream.set_format(m_trace.format);
+        instream.set_sample_rate(m_trace.sample_rate);
+        ChannelLayout layout;
+        layout.set_channels(m_trace.channels);
+        layout.detect_builtin();
+        instream.set_layout(layout);
+        return instream;
+    }
+
+    int CallbackReplayer::replay(int callback_count)
+    {
+        if (m_outstream == nullptr && m_instream == nullptr) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        m_callback_seconds.reserve(m_trace.events.size());
+
+        int replayed = 0;
+        bool paced = false;
+        std::chrono::steady_clock::time_point base;
+        while (m_position < m_trace.events.size() &&
+                (callback_count < 0 || replayed < callback_count)) {
+            const CallbackEvent& event = m_trace.events[m_position];
+            m_position++;
+            if (event.type == CallbackEventType::Frames) {
+                // Left over from a callback that asked for fewer
+                continue;
+            }
+            if (m_realtime) {
+                std::chrono::nanoseconds offset(event.time);
+                if (!paced) {
+                    base = std::chrono::steady_clock::now() - offset;
+                    paced = true;
+                }
+                std::this_thread::sleep_until(base + offset);
+            }
+
+            if (event.type == CallbackEventType::Xrun) {
+                if (m_outstream != nullptr) {
+                    underflow_callback(m_outstream);
+                } else {
+                    overflow_callback(m_instream);
+                }
+                continue;
+            }
+
+            m_budget = event.frame_count_max;
+            auto start_time = std::chrono::steady_clock::now();
+            if (m_outstream != nullptr) {
+                write_callback(m_outstream,
+                    event.frame_count_min, event.frame_count_max);
+            } else {
+                read_callback(m_instream,
+                    event.frame_count_min, event.frame_count_max);
+            }
+            std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start_time;
+            m_callback_seconds.push_back(elapsed.count());
+            m_budget = 0;
+            replayed++;
+        }
+        return replayed;
+    }
+
+    void CallbackReplayer::rewind()
+    {
+        m_position = 0;
+        m_callback_seconds.clear();
+    }
+
+    // Getters/Setters
+
+    const CallbackTrace& CallbackReplayer::get_trace() const
+    {
+        return m_trace;
+    }
+
+    void CallbackReplayer::set_trace(const CallbackTrace& trace)
+    {
+        m_trace = trace;
+        m_max_frames = 0;
+        for (size_t i = 0; i < m_trace.events.size(); i++) {
+            if (m_trace.events[i].frame_count_max > m_max_frames) {
+                m_max_frames = m_trace.events[i].frame_count_max;
+            }
+        }
+        rewind();
+        if (m_outstream != nullptr) {
+            prepare(m_outstream->bytes_per_frame,
+                m_outstream->bytes_per_sample, m_outstream->layout.channel_count);
+        } else if (m_instream != nullptr) {
+            prepare(m_instream->bytes_per_frame,
+                m_instream->bytes_per_sample, m_instream->layout.channel_count);
+        }
+    }
+
+    bool CallbackReplayer::get_realtime() const
+    {
+        return m_realtime;
+    }
+
+    void CallbackReplayer::set_realtime(bool realtime)
+    {
+        m_realtime = realtime;
+    }
+
+    size_t CallbackReplayer::get_position() const
+    {
+        return m_position;
+    }
+
+    const std::vector<double>& CallbackReplayer::get_callback_seconds() const
+    {
+        return m_callback_seconds;
+    }
+
+    // Driver
+
+    void CallbackReplayer::open(OutStream* outstream)
+    {
+        m_outstream = *outstream;
+        m_instream = nullptr;
+        prepare(m_outstream->bytes_per_frame, m_outstream->bytes_per_sample,
+            m_outstream->layout.channel_count);
+    }
+
+    void CallbackReplayer::close(OutStream* outstream)
+    {
+        if (m_outstream == static_cast<SoundIoOutStream*>(*outstream)) {
+            m_outstream = nullptr;
+        }
+    }
+
+    ErrorId CallbackReplayer::begin_write(OutStream* outstream,
+        ChannelArea*& areas, int& frame_count) noexcept
+    {
+        (void)outstream;
+        frame_count = grant(frame_count);
+        areas = m_areas.data();
+        return ErrorId::None;
+    }
+
+    ErrorId CallbackReplayer::end_write(OutStream* outstream) noexcept
+    {
+        (void)outstream;
+        m_budget -= m_granted;
+        m_granted = 0;
+        return ErrorId::None;
+    }
+
+    void CallbackReplayer::open(InStream* instream)
+    {
+        m_instream = *instream;
+        m_outstream = nullptr;
+        prepare(m_instream->bytes_per_frame, m_instream->bytes_per_sample,
+            m_instream->layout.channel_count);
+    }
+
+    void CallbackReplayer::close(InStream* instream)
+    {
+        if (m_instream == static_cast<SoundIoInStream*>(*instream)) {
+            m_instream = nullptr;
+        }
+    }
+
+    ErrorId CallbackReplayer::begin_read(InStream* instream,
+        ChannelArea*& areas, int& frame_count) noexcept
+    {
+        (void)instream;
+        frame_count = grant(frame_count);
+        areas = m_areas.data();
+        return ErrorId::None;
+    }
+
+    ErrorId CallbackReplayer::end_read(InStream* instream) noexcept
+    {
+        (void)instream;
+        m_budget -= m_granted;
+        m_granted = 0;
+        return ErrorId::None;
+    }
+
+    void CallbackReplayer::prepare(int bytes_per_frame, int bytes_per_sample,
+        int channel_count)
+    {
+        // One callback's worth, written over by every write and read as
+        // silence by every read
+        m_buffer.assign(static_cast<size_t>(m_max_frames) * bytes_per_frame, 0);
+        m_areas.resize(channel_count);
+        for (int ch = 0; ch < channel_count; ch++) {
+            m_areas[ch].ptr = m_buffer.data() + ch * bytes_per_sample;
+            m_areas[ch].step = bytes_per_frame;
+        }
+    }
+
+    int CallbackReplayer::grant(int frame_count)
+    {
+        // The backend handed out what it did back then, never more than
+        // asked for or left in this callback
+        if (m_position < m_trace.events.size() &&
+                m_trace.events[m_position].type == CallbackEventType::Frames) {
+            int recorded = m_trace.events[m_position].frame_count_max;
+            if (frame_count > recorded) {
+                frame_count = recorded;
+            }
+            m_position++;
+        }
+        if (frame_count > m_budget) {
+            frame_count = m_budget;
+        }
+        m_granted = frame_count;
+        return frame_count;
+    }
+}
@@ -0,0 +1,124 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/clock.h"
+
+namespace sio
+{
+    static const double pi = 3.14159265358979323846;
+
+    StreamClock::StreamClock()
+    {
+        m_filter.frame = 0;
+        m_filter.time = 0.0;
+        m_filter.period = 0.0;
+        m_locked = false;
+        m_position = 0;
+        m_bandwidth = 1.0;
+        m_reset_threshold = 0.05;
+    }
+
+    void StreamClock::reset()
+    {
+        m_locked = false;
+        m_position = 0;
+    }
+
+    void StreamClock::update(double time, int sample_rate)
+    {
+        long long position = m_position.load(std::memory_order_relaxed);
+        if (!m_locked) {
+            m_filter.frame = position;
+            m_filter.time = time;
+            m_filter.period = 1.0 / sample_rate;
+            m_locked = true;
+            m_state.store(m_filter);
+            return;
+        }
+
+        long long frames = position - m_filter.frame;
+        if (frames <= 0) {
+            return;
+        }
+        double predicted = m_filter.time + frames * m_filter.period;
+        double error = time - predicted;
+        if (std::fabs(error) > m_reset_threshold) {
+            // Xrun or pause, the old estimate is useless
+            m_locked = false;
+            update(time, sample_rate);
+            return;
+        }
+
+        double omega = 2.0 * pi * m_bandwidth * frames * m_filter.period;
+        double b = std::sqrt(2.0) * omega;
+        double c = omega * omega;
+        m_filter.frame = position;
+        m_filter.time = predicted + b * error;
+        m_filter.period += c * error / frames;
+        m_state.store(m_filter);
+    }
+
+    void StreamClock::advance(int frame_count)
+    {
+        m_position.fetch_add(frame_count, std::memory_order_relaxed);
+    }
+
+    double StreamClock::frame_to_time(long long frame) const
+    {
+        State state = m_state.load();
+        return state.time + (frame - state.frame) * state.period;
+    }
+
+    long long StreamClock::time_to_frame(double time) const
+    {
+        State state = m_state.load();
+        if (state.period == 0.0) {
+            return 0;
+        }
+        return state.frame + static_cast<long long>(
+            std::floor((time - state.time) / state.period + 0.5));
+    }
+
+    double StreamClock::now()
+    {
+        // CLOCK_MONOTONIC on Linux
+        std::chrono::duration<double> time =
+            std::chrono::steady_clock::now().time_since_epoch();
+        return time.count();
+    }
+
+    // Getters/Setters
+
+    long long StreamClock::get_position() const
+    {
+        return m_position.load(std::memory_order_relaxed);
+    }
+
+    double StreamClock::get_rate() const
+    {
+        State state = m_state.load();
+        return state.period != 0.0 ? 1.0 / state.period : 0.0;
+    }
+
+    double StreamClock::get_bandwidth() const
+    {
+        return m_bandwidth;
+    }
+
+    void StreamClock::set_bandwidth(double bandwidth)
+    {
+        m_bandwidth = bandwidth;
+    }
+
+    double StreamClock::get_reset_threshold() const
+    {
+        return m_reset_threshold;
+    }
+
+    void StreamClock::set_reset_threshold(double threshold)
+    {
+        m_reset_threshold = threshold;
+    }
+}
@@ -1,10 +1,99 @@
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <functional>
+#include <thread>
+#include <vector>
 #include "soundio/soundio.h"
 #include "soundiopp/soundiopp.h"
+#include "soundiopp/trace.h"
 
 namespace sio
 {
+    static double monotonic_seconds()
+    {
+        return std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static bool same_device(const DeviceEntry& a, const DeviceEntry& b)
+    {
+        return a.id == b.id && a.aim == b.aim && a.is_raw == b.is_raw;
+    }
+
+    static std::string default_device_id(SoundIo* soundio, bool input)
+    {
+        int index = input ? soundio_default_input_device_index(soundio)
+            : soundio_default_output_device_index(soundio);
+        if (index < 0) {
+            return std::string();
+        }
+        SoundIoDevice* device = input ? soundio_get_input_device(soundio, index)
+            : soundio_get_output_device(soundio, index);
+        if (device == nullptr) {
+            return std::string();
+        }
+        std::string id = device->id;
+        soundio_device_unref(device);
+        return id;
+    }
+
+    // Shared with the probe threads, which may outlive connect_parallel()
+    // when a backend hangs
+    struct ProbeGroup
+    {
+        struct Slot
+        {
+            SoundIoBackend backend;
+            SoundIo* soundio;
+            int err;
+            bool done;
+            bool abandoned;
+            double seconds;
+        };
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::vector<Slot> slots;
+        std::string app_name;
+        emit_rtprio_callback_t emit_rtprio_warning;
+        jack_callback_t jack_info_callback;
+        jack_callback_t jack_error_callback;
+    };
+
+    static void run_probe(std::shared_ptr<ProbeGroup> group, size_t index)
+    {
+        double start = monotonic_seconds();
+        SoundIo* soundio = soundio_create();
+        int err = SoundIoErrorNoMem;
+        if (soundio != nullptr) {
+            soundio->app_name = group->app_name.c_str();
+            soundio->emit_rtprio_warning = group->emit_rtprio_warning;
+            soundio->jack_info_callback = group->jack_info_callback;
+            soundio->jack_error_callback = group->jack_error_callback;
+            err = soundio_connect_backend(soundio,
+                group->slots[index].backend);
+        }
+
+        std::unique_lock<std::mutex> lock(group->mutex);
+        ProbeGroup::Slot& slot = group->slots[index];
+        slot.soundio = soundio;
+        slot.err = err;
+        slot.done = true;
+        slot.seconds = monotonic_seconds() - start;
+        if (slot.abandoned) {
+            slot.soundio = nullptr;
+            lock.unlock();
+            if (soundio != nullptr) {
+                soundio_destroy(soundio);
+            }
+            return;
+        }
+        group->condition.notify_all();
+    }
+
     Context::Context()
     {
         m_soundio = soundio_create();
@@ -12,12 +101,23 @@ namespace sio
             throw std::bad_alloc();
         }
         m_userdata = nullptr;
+        m_tracer = nullptr;
+        m_worker_pool = nullptr;
+        m_devices_pending = false;
+        m_devices_changed_at = 0.0;
+        m_devices_debounce = 0.25;
+        m_soundio->userdata = this;
     }
 
     Context::Context(SoundIo* soundio)
     {
         m_soundio = soundio;
         m_userdata = m_soundio->userdata;
+        m_tracer = nullptr;
+        m_worker_pool = nullptr;
+        m_devices_pending = false;
+        m_devices_changed_at = 0.0;
+        m_devices_debounce = 0.25;
         m_soundio->userdata = this;
     }
 
@@ -26,7 +126,17 @@ namespace sio
         m_soundio = other.m_soundio;
         m_app_name = other.m_app_name;
         m_userdata = other.m_userdata;
+        m_tracer = other.m_tracer;
+        m_worker_pool = other.m_worker_pool;
+        m_connect_report = other.m_connect_report;
+        m_devices = other.m_devices;
+        m_default_input = other.m_default_input;
+        m_default_output = other.m_default_output;
+        m_devices_pending = other.m_devices_pending;
+        m_devices_changed_at = other.m_devices_changed_at;
+        m_devices_debounce = other.m_devices_debounce;
         m_on_devices_change = other.m_on_devices_change;
+        m_on_devices_diff = other.m_on_devices_diff;
         m_on_backend_disconnect = other.m_on_backend_disconnect;
         m_on_events_signal = other.m_on_events_signal;
         m_soundio->userdata = this;
@@ -46,7 +156,17 @@ namespace sio
         m_soundio = other.m_soundio;
         m_app_name = other.m_app_name;
         m_userdata = other.m_userdata;
+        m_tracer = other.m_tracer;
+        m_worker_pool = other.m_worker_pool;
+        m_connect_report = other.m_connect_report;
+        m_devices = other.m_devices;
+        m_default_input = other.m_default_input;
+        m_default_output = other.m_default_output;
+        m_devices_pending = other.m_devices_pending;
+        m_devices_changed_at = other.m_devices_changed_at;
+        m_devices_debounce = other.m_devices_debounce;
         m_on_devices_change = other.m_on_devices_change;
+        m_on_devices_diff = other.m_on_devices_diff;
         m_on_backend_disconnect = other.m_on_backend_disconnect;
         m_on_events_signal = other.m_on_events_signal;
         m_soundio->userdata = this;
@@ -75,6 +195,101 @@ namespace sio
         WRAP_SOUNDIO_ERROR(soundio_connect_backend(m_soundio, backend));
     }
 
+    ConnectReport Context::connect_parallel(double timeout)
+    {
+        double start = monotonic_seconds();
+        auto group = std::make_shared<ProbeGroup>();
+        group->app_name = m_soundio->app_name != nullptr ?
+            m_soundio->app_name : "";
+        group->emit_rtprio_warning = m_soundio->emit_rtprio_warning;
+        group->jack_info_callback = m_soundio->jack_info_callback;
+        group->jack_error_callback = m_soundio->jack_error_callback;
+        int count = backend_count();
+        for (int i = 0; i < count; i++) {
+            ProbeGroup::Slot slot = {
+                get_backend(i), nullptr, 0, false, false, 0.0
+            };
+            group->slots.push_back(slot);
+        }
+        for (size_t i = 0; i < group->slots.size(); i++) {
+            std::thread(run_probe, group, i).detach();
+        }
+
+        // Backends come in priority order, take the first that connects
+        // while waiting at most until the deadline for slower ones. Capped
+        // at a day so the deadline cannot overflow.
+        if (!(timeout > 0.0)) {
+            timeout = 0.0;
+        } else if (timeout > 86400.0) {
+            timeout = 86400.0;
+        }
+        auto deadline = std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(timeout));
+        std::unique_lock<std::mutex> lock(group->mutex);
+        int chosen = -1;
+        int first_error = SoundIoErrorNoSuchClient;
+        bool have_error = false;
+        for (size_t i = 0; i < group->slots.size() && chosen < 0; i++) {
+            ProbeGroup::Slot& slot = group->slots[i];
+            group->condition.wait_until(lock, deadline,
+                [&slot] { return slot.done; });
+            if (slot.done && slot.err == 0) {
+                chosen = static_cast<int>(i);
+            } else if (slot.done && !have_error) {
+                first_error = slot.err;
+                have_error = true;
+            }
+        }
+        double decided = monotonic_seconds() - start;
+        bool expired = std::chrono::steady_clock::now() >= deadline;
+
+        ConnectReport report;
+        report.chosen = BackendId::None;
+        SoundIo* adopted = nullptr;
+        for (size_t i = 0; i < group->slots.size(); i++) {
+            ProbeGroup::Slot& slot = group->slots[i];
+            BackendProbe probe;
+            probe.backend = static_cast<BackendId>(slot.backend);
+            probe.pending = !slot.done;
+            probe.timed_out = probe.pending && expired;
+            probe.result = slot.done ?
+                static_cast<ErrorId>(slot.err) : ErrorId::None;
+            probe.seconds = slot.done ? slot.seconds : decided;
+            report.probes.push_back(probe);
+
+            if (static_cast<int>(i) == chosen) {
+                adopted = slot.soundio;
+                slot.soundio = nullptr;
+                report.chosen = probe.backend;
+            } else if (slot.done) {
+                if (slot.soundio != nullptr) {
+                    soundio_destroy(slot.soundio);
+                    slot.soundio = nullptr;
+                }
+            } else {
+                // Still stuck in connect, the thread cleans up after itself
+                slot.abandoned = true;
+            }
+        }
+        lock.unlock();
+        report.seconds = monotonic_seconds() - start;
+        m_connect_report = report;
+
+        if (adopted == nullptr) {
+            throw soundio_error(first_error);
+        }
+        // Carry everything set on the unconnected instance over
+        adopted->app_name = m_soundio->app_name;
+        adopted->userdata = this;
+        adopted->on_devices_change = m_soundio->on_devices_change;
+        adopted->on_backend_disconnect = m_soundio->on_backend_disconnect;
+        adopted->on_events_signal = m_soundio->on_events_signal;
+        soundio_destroy(m_soundio);
+        m_soundio = adopted;
+        return report;
+    }
+
     void Context::disconnect()
     {
         soundio_disconnect(m_soundio);
@@ -93,11 +308,45 @@ namespace sio
     void Context::flush_events()
     {
         soundio_flush_events(m_soundio);
+        deliver_devices_diff();
     }
 
     void Context::wait_events()
     {
-        soundio_wait_events(m_soundio);
+        double remaining = m_devices_changed_at + m_devices_debounce
+            - monotonic_seconds();
+        if (!m_devices_pending || !m_on_devices_diff) {
+            soundio_wait_events(m_soundio);
+        } else if (remaining <= 0.0) {
+            soundio_flush_events(m_soundio);
+        } else {
+            // Nothing wakes the backend when the debounce delay runs out, so
+            // a timer does. wakeup() still ends the wait early. Capped, the
+            // caller waits again if the diff is still pending.
+            if (remaining > 3600.0) {
+                remaining = 3600.0;
+            }
+            std::mutex mutex;
+            std::condition_variable condition;
+            bool returned = false;
+            SoundIo* soundio = m_soundio;
+            std::thread timer([&] {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (!condition.wait_for(lock,
+                        std::chrono::duration<double>(remaining),
+                        [&returned] { return returned; })) {
+                    soundio_wakeup(soundio);
+                }
+            });
+            soundio_wait_events(m_soundio);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                returned = true;
+            }
+            condition.notify_one();
+            timer.join();
+        }
+        deliver_devices_diff();
     }
 
     void Context::wakeup()
@@ -130,6 +379,36 @@ namespace sio
         return Device(soundio_get_output_device(m_soundio, index), this);
     }
 
+    Device Context::get_device(const DeviceEntry& entry)
+    {
+        bool input = entry.aim == DeviceAimId::Input;
+        int count = input ? input_device_count() : output_device_count();
+        // The recorded index is right unless the list changed since
+        for (int n = -1; n < count; n++) {
+            int index = n < 0 ? entry.index : n;
+            if (index < 0 || index >= count || (n >= 0 && n == entry.index)) {
+                continue;
+            }
+            SoundIoDevice* device = input ?
+                soundio_get_input_device(m_soundio, index) :
+                soundio_get_output_device(m_soundio, index);
+            if (device == nullptr) {
+                continue;
+            }
+            if (entry.id != device->id || entry.is_raw != device->is_raw) {
+                soundio_device_unref(device);
+                continue;
+            }
+            if (device->probe_error) {
+                int err = device->probe_error;
+                soundio_device_unref(device);
+                throw soundio_error(err);
+            }
+            return Device(device, this);
+        }
+        throw soundio_error(ErrorId::NoSuchDevice);
+    }
+
     RingBuffer Context::create_ring_buffer(int requested_capacity)
     {
         return RingBuffer(soundio_ring_buffer_create(
@@ -164,6 +443,11 @@ namespace sio
         m_soundio->app_name = name.c_str();
     }
 
+    ConnectReport Context::get_connect_report() const
+    {
+        return m_connect_report;
+    }
+
     std::function<void(Context*)> Context::get_on_devices_change()
     {
         return m_on_devices_change;
@@ -188,6 +472,29 @@ namespace sio
         m_soundio->on_backend_disconnect = on_backend_disconnect_wrapper;
     }
 
+    std::function<void(Context*, const DeviceDiff&)>
+        Context::get_on_devices_diff()
+    {
+        return m_on_devices_diff;
+    }
+
+    void Context::set_on_devices_diff(
+        std::function<void(Context*, const DeviceDiff&)> on_devices_diff)
+    {
+        m_on_devices_diff = on_devices_diff;
+        m_soundio->on_devices_change = on_devices_change_wrapper;
+    }
+
+    double Context::get_devices_debounce() const
+    {
+        return m_devices_debounce;
+    }
+
+    void Context::set_devices_debounce(double seconds)
+    {
+        m_devices_debounce = seconds;
+    }
+
     std::function<void(Context*)> Context::get_on_events_signal()
     {
         return m_on_events_signal;
@@ -233,16 +540,45 @@ namespace sio
         m_soundio->jack_error_callback = jack_error_callback;
     }
 
+    Tracer* Context::get_tracer()
+    {
+        return m_tracer;
+    }
+
+    void Context::set_tracer(Tracer* tracer)
+    {
+        m_tracer = tracer;
+    }
+
+    WorkerPool* Context::get_worker_pool()
+    {
+        return m_worker_pool;
+    }
+
+    void Context::set_worker_pool(WorkerPool* worker_pool)
+    {
+        m_worker_pool = worker_pool;
+    }
+
     void Context::on_devices_change_wrapper(SoundIo* soundio)
     {
         Context* context = static_cast<Context*>(soundio->userdata);
+        TraceScope trace(context->m_tracer, "devices_change");
+        // Diffs wait until the device list has settled
+        context->m_devices_pending = true;
+        context->m_devices_changed_at = monotonic_seconds();
         auto cb = context->get_on_devices_change();
-        cb(context);
+        if (cb) {
+            cb(context);
+        }
     }
 
     void Context::on_backend_disconnect_wrapper(SoundIo* soundio, int err)
     {
         Context* context = static_cast<Context*>(soundio->userdata);
+        if (context->m_tracer != nullptr) {
+            context->m_tracer->instant("backend_disconnect");
+        }
         auto cb = context->get_on_backend_disconnect();
         cb(context, static_cast<ErrorId>(err));
     }
@@ -253,4 +589,120 @@ namespace sio
         auto cb = context->get_on_events_signal();
         cb(context);
     }
+
+    std::vector<Context::DeviceSnapshot> Context::snapshot_devices()
+    {
+        std::vector<DeviceSnapshot> snapshots;
+        for (int aim = 0; aim < 2; aim++) {
+            bool input = aim == 0;
+            int count = input ? soundio_input_device_count(m_soundio) :
+                soundio_output_device_count(m_soundio);
+            for (int i = 0; i < count; i++) {
+                SoundIoDevice* device = input ?
+                    soundio_get_input_device(m_soundio, i) :
+                    soundio_get_output_device(m_soundio, i);
+                if (device == nullptr) {
+                    continue;
+                }
+                // Only what the backend scan already filled in, nothing
+                // here probes the hardware
+                DeviceSnapshot snapshot;
+                snapshot.entry.id = device->id;
+                snapshot.entry.name = device->name;
+                snapshot.entry.aim = static_cast<DeviceAimId>(device->aim);
+                snapshot.entry.is_raw = device->is_raw;
+                snapshot.entry.index = i;
+                snapshot.entry.probe_error =
+                    static_cast<ErrorId>(device->probe_error);
+                for (int l = 0; l < device->layout_count; l++) {
+                    const SoundIoChannelLayout& layout = device->layouts[l];
+                    snapshot.layouts.push_back(std::string(
+                        layout.name != nullptr ? layout.name : "")
+                        + ':' + std::to_string(layout.channel_count));
+                }
+                snapshot.formats.assign(device->formats,
+                    device->formats + device->format_count);
+                for (int r = 0; r < device->sample_rate_count; r++) {
+                    snapshot.sample_rates.push_back(
+                        device->sample_rates[r].min);
+                    snapshot.sample_rates.push_back(
+                        device->sample_rates[r].max);
+                }
+                snapshot.current_format = device->current_format;
+                snapshot.current_sample_rate = device->sample_rate_current;
+                snapshot.software_latency_min = device->software_latency_min;
+                snapshot.software_latency_max = device->software_latency_max;
+                snapshots.push_back(snapshot);
+                soundio_device_unref(device);
+            }
+        }
+        return snapshots;
+    }
+
+    void Context::deliver_devices_diff()
+    {
+        if (!m_devices_pending || !m_on_devices_diff ||
+                monotonic_seconds() - m_devices_changed_at
+                    < m_devices_debounce) {
+            return;
+        }
+        m_devices_pending = false;
+
+        std::vector<DeviceSnapshot> devices = snapshot_devices();
+        DeviceDiff diff;
+        for (const DeviceSnapshot& current : devices) {
+            const DeviceSnapshot* previous = nullptr;
+            for (const DeviceSnapshot& snapshot : m_devices) {
+                if (same_device(snapshot.entry, current.entry)) {
+                    previous = &snapshot;
+                    break;
+                }
+            }
+            if (previous == nullptr) {
+                diff.added.push_back(current.entry);
+            } else if (previous->entry.name != current.entry.name ||
+                    previous->entry.probe_error != current.entry.probe_error ||
+                    previous->layouts != current.layouts ||
+                    previous->formats != current.formats ||
+                    previous->sample_rates != current.sample_rates ||
+                    previous->current_format != current.current_format ||
+                    previous->current_sample_rate !=
+                        current.current_sample_rate ||
+                    previous->software_latency_min !=
+                        current.software_latency_min ||
+                    previous->software_latency_max !=
+                        current.software_latency_max) {
+                diff.changed.push_back(current.entry);
+            }
+        }
+        for (const DeviceSnapshot& previous : m_devices) {
+            bool found = false;
+            for (const DeviceSnapshot& current : devices) {
+                if (same_device(previous.entry, current.entry)) {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                diff.removed.push_back(previous.entry);
+                diff.removed.back().index = -1;
+            }
+        }
+
+        std::string default_input = default_device_id(m_soundio, true);
+        std::string default_output = default_device_id(m_soundio, false);
+        diff.default_input_changed = default_input != m_default_input;
+        diff.default_output_changed = default_output != m_default_output;
+        m_devices.swap(devices);
+        m_default_input = default_input;
+        m_default_output = default_output;
+
+        if (diff.added.empty() && diff.removed.empty() &&
+                diff.changed.empty() && !diff.default_input_changed &&
+                !diff.default_output_changed) {
+            return;
+        }
+        auto cb = get_on_devices_diff();
+        cb(this, diff);
+    }
 }
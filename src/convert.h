@@ -0,0 +1,140 @@
+#ifndef SOUNDIOPP_CONVERT_H
+#define SOUNDIOPP_CONVERT_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace sio
+{
+    template<typename Sample>
+    struct ScaledReader
+    {
+        static float read(const char* ptr, float scale)
+        {
+            Sample sample;
+            std::memcpy(&sample, ptr, sizeof(Sample));
+            return static_cast<float>(sample) * scale;
+        }
+    };
+
+    struct S24Reader
+    {
+        static float read(const char* ptr, float scale)
+        {
+            uint32_t sample;
+            std::memcpy(&sample, ptr, sizeof(sample));
+            // Sign extend from the low three bytes
+            return static_cast<float>(static_cast<int32_t>(sample << 8) >> 8)
+                * scale;
+        }
+    };
+
+    struct U8Reader
+    {
+        static float read(const char* ptr, float scale)
+        {
+            return (static_cast<uint8_t>(*ptr) - 128) * scale;
+        }
+    };
+
+    // Calls visitor.apply<Reader>(scale) with the reader that turns samples
+    // of the given format into floats in [-1, 1). Returns false for formats
+    // without a reader.
+    template<typename Visitor>
+    bool visit_reader(SoundIoFormat format, Visitor& visitor)
+    {
+        switch (format) {
+        case SoundIoFormatFloat32NE:
+            visitor.template apply<ScaledReader<float>>(1.0f);
+            return true;
+        case SoundIoFormatFloat64NE:
+            visitor.template apply<ScaledReader<double>>(1.0f);
+            return true;
+        case SoundIoFormatS32NE:
+            visitor.template apply<ScaledReader<int32_t>>(
+                1.0f / 2147483648.0f);
+            return true;
+        case SoundIoFormatS24NE:
+            visitor.template apply<S24Reader>(1.0f / 8388608.0f);
+            return true;
+        case SoundIoFormatS16NE:
+            visitor.template apply<ScaledReader<int16_t>>(1.0f / 32768.0f);
+            return true;
+        case SoundIoFormatS8:
+            visitor.template apply<ScaledReader<int8_t>>(1.0f / 128.0f);
+            return true;
+        case SoundIoFormatU8:
+            visitor.template apply<U8Reader>(1.0f / 128.0f);
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    template<typename Sample>
+    struct ScaledWriter
+    {
+        static void write(char* ptr, int32_t value)
+        {
+            Sample sample = static_cast<Sample>(value);
+            std::memcpy(ptr, &sample, sizeof(Sample));
+        }
+    };
+
+    struct U8Writer
+    {
+        static void write(char* ptr, int32_t value)
+        {
+            *ptr = static_cast<char>(static_cast<uint8_t>(value + 128));
+        }
+    };
+
+    // Calls visitor.apply<Writer>(scale, max) for integer formats, Writer
+    // stores values already scaled to [-scale, max]. S24 uses the low three
+    // bytes of a 32 bit word like the reader. Returns false for formats
+    // without an integer writer.
+    template<typename Visitor>
+    bool visit_writer(SoundIoFormat format, Visitor& visitor)
+    {
+        switch (format) {
+        case SoundIoFormatS32NE:
+            // Largest float below 2^31
+            visitor.template apply<ScaledWriter<int32_t>>(
+                2147483648.0f, 2147483520.0f);
+            return true;
+        case SoundIoFormatS24NE:
+            visitor.template apply<ScaledWriter<int32_t>>(
+                8388608.0f, 8388607.0f);
+            return true;
+        case SoundIoFormatS16NE:
+            visitor.template apply<ScaledWriter<int16_t>>(32768.0f, 32767.0f);
+            return true;
+        case SoundIoFormatS8:
+            visitor.template apply<ScaledWriter<int8_t>>(128.0f, 127.0f);
+            return true;
+        case SoundIoFormatU8:
+            visitor.template apply<U8Writer>(128.0f, 127.0f);
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    struct ReadVisitor
+    {
+        const char* ptr;
+        int step;
+        int frame_count;
+        float* output;
+
+        template<typename Reader>
+        void apply(float scale)
+        {
+            for (int i = 0; i < frame_count; i++) {
+                output[i] = Reader::read(ptr + i * step, scale);
+            }
+        }
+    };
+}
+
+#endif // SOUNDIOPP_CONVERT_H
@@ -0,0 +1,442 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <thread>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/convolver.h"
+#include "soundiopp/threading.h"
+#include "convert.h"
+
+namespace sio
+{
+    static bool is_power_of_two(int value)
+    {
+        return value > 0 && (value & (value - 1)) == 0;
+    }
+
+    Convolver::Scratch::Scratch(int block_size)
+        : fft(block_size * 2)
+    {
+        spectrum.resize(block_size + 1);
+        time.resize(block_size * 2);
+    }
+
+    Convolver::Stage::Stage(int block_size, int spare_slots)
+        : scratch(block_size)
+    {
+        this->block_size = block_size;
+        this->spare_slots = spare_slots;
+        delay_pos = 0;
+    }
+
+    void Convolver::Stage::set_filter(const float* taps, int length)
+    {
+        int partition_count = (length + block_size - 1) / block_size;
+        filters.assign(partition_count,
+            std::vector<std::complex<float>>(block_size + 1));
+        delay_line.assign(partition_count > 0 ?
+            partition_count + spare_slots : 0,
+            std::vector<std::complex<float>>(block_size + 1));
+        delay_pos = 0;
+        std::vector<float>& time = scratch.time;
+        for (int p = 0; p < partition_count; p++) {
+            int count = length - p * block_size;
+            if (count > block_size) {
+                count = block_size;
+            }
+            std::fill(time.begin(), time.end(), 0.0f);
+            std::copy(taps + p * block_size, taps + p * block_size + count,
+                time.begin());
+            scratch.fft.forward(time.data(), filters[p].data());
+        }
+    }
+
+    void Convolver::Stage::push(const float* window)
+    {
+        int slot_count = static_cast<int>(delay_line.size());
+        if (slot_count == 0) {
+            return;
+        }
+        delay_pos = delay_pos + 1 == slot_count ? 0 : delay_pos + 1;
+        scratch.fft.forward(window, delay_line[delay_pos].data());
+    }
+
+    void Convolver::Stage::convolve(int pos, Scratch& scratch,
+        float* output) const
+    {
+        int partition_count = static_cast<int>(filters.size());
+        if (partition_count == 0) {
+            std::fill(output, output + block_size, 0.0f);
+            return;
+        }
+        int slot_count = static_cast<int>(delay_line.size());
+        std::vector<std::complex<float>>& spectrum = scratch.spectrum;
+        std::fill(spectrum.begin(), spectrum.end(), std::complex<float>());
+        for (int p = 0; p < partition_count; p++) {
+            const std::complex<float>* filter = filters[p].data();
+            const std::complex<float>* input = delay_line[pos].data();
+            for (int k = 0; k <= block_size; k++) {
+                spectrum[k] += filter[k] * input[k];
+            }
+            pos = pos == 0 ? slot_count - 1 : pos - 1;
+        }
+
+        // Overlap-save, the first half is circular aliasing
+        scratch.fft.inverse(spectrum.data(), scratch.time.data());
+        std::copy(scratch.time.begin() + block_size, scratch.time.end(),
+            output);
+    }
+
+    void Convolver::Stage::process(const float* window, float* output)
+    {
+        push(window);
+        convolve(delay_pos, scratch, output);
+    }
+
+    void Convolver::Stage::reset()
+    {
+        for (auto& spectra : delay_line) {
+            std::fill(spectra.begin(), spectra.end(), std::complex<float>());
+        }
+        delay_pos = 0;
+    }
+
+    Convolver::Channel::Channel(int head_size, int tail_size)
+        : early(head_size, 0), late(tail_size, 1), worker(tail_size)
+    {
+        head.resize(head_size);
+        input.resize(head_size * 2);
+        early_output.resize(head_size);
+        tail_input.resize(tail_size * 2);
+        tail_result.resize(tail_size);
+        tail_spare.resize(tail_size);
+        tail_output.resize(tail_size);
+    }
+
+    Convolver::Convolver(int channel_count, int head_size, int tail_size)
+    {
+        if (channel_count < 1 || channel_count > SOUNDIO_MAX_CHANNELS ||
+                head_size < 2 || !is_power_of_two(head_size) ||
+                tail_size < head_size || !is_power_of_two(tail_size)) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        m_head_size = head_size;
+        m_tail_size = tail_size;
+        for (int ch = 0; ch < channel_count; ch++) {
+            m_channels.emplace_back(head_size, tail_size);
+        }
+        m_convert.resize(channel_count, std::vector<float>(max_block));
+        for (auto& samples : m_convert) {
+            m_convert_ptrs.push_back(samples.data());
+        }
+        m_head_pos = 0;
+        m_tail_pos = 0;
+        m_tail_state = TailIdle;
+        m_tail_slot = 0;
+        m_abandoned = 0;
+        m_tail_inline = false;
+        m_stalled = false;
+        m_late_blocks = 0;
+        m_running = false;
+    }
+
+    Convolver::~Convolver()
+    {
+        stop();
+    }
+
+    void Convolver::set_impulse(int channel, const float* impulse, int length)
+    {
+        if (channel < 0 || channel >= get_channel_count() || length < 0) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        Channel& state = m_channels[channel];
+        std::fill(state.head.begin(), state.head.end(), 0.0f);
+        int head_length = length < m_head_size ? length : m_head_size;
+        // Reversed so the direct part runs forward through the history
+        for (int k = 0; k < head_length; k++) {
+            state.head[m_head_size - 1 - k] = impulse[k];
+        }
+
+        int early_end = 2 * m_tail_size;
+        int early_length = (length < early_end ? length : early_end)
+            - m_head_size;
+        if (early_length > 0) {
+            state.early.set_filter(impulse + m_head_size, early_length);
+        } else {
+            state.early.set_filter(impulse, 0);
+        }
+        int late_length = length - early_end;
+        if (late_length > 0) {
+            state.late.set_filter(impulse + early_end, late_length);
+        } else {
+            state.late.set_filter(impulse, 0);
+        }
+    }
+
+    void Convolver::process(const float* const* input, float* const* output,
+        int frame_count)
+    {
+        int channel_count = get_channel_count();
+        int offset = 0;
+        while (offset < frame_count) {
+            int chunk = m_head_size - m_head_pos;
+            if (chunk > frame_count - offset) {
+                chunk = frame_count - offset;
+            }
+
+            for (int ch = 0; ch < channel_count; ch++) {
+                Channel& state = m_channels[ch];
+                std::copy(input[ch] + offset, input[ch] + offset + chunk,
+                    state.input.begin() + m_head_size + m_head_pos);
+                std::copy(input[ch] + offset, input[ch] + offset + chunk,
+                    state.tail_input.begin() + m_tail_size + m_tail_pos);
+
+                const float* taps = state.head.data();
+                for (int i = 0; i < chunk; i++) {
+                    const float* history = state.input.data() + m_head_pos
+                        + i + 1;
+                    float sum = state.early_output[m_head_pos + i]
+                        + state.tail_output[m_tail_pos + i];
+                    for (int k = 0; k < m_head_size; k++) {
+                        sum += taps[k] * history[k];
+                    }
+                    output[ch][offset + i] = sum;
+                }
+            }
+            offset += chunk;
+            advance(chunk);
+        }
+    }
+
+    bool Convolver::process(FormatId format, const ChannelArea* areas,
+        int channel_count, int frame_count)
+    {
+        if (channel_count != get_channel_count()) {
+            return false;
+        }
+        for (int offset = 0; offset < frame_count; offset += max_block) {
+            int chunk = frame_count - offset;
+            if (chunk > max_block) {
+                chunk = max_block;
+            }
+            ChannelArea chunk_areas[SOUNDIO_MAX_CHANNELS];
+            for (int ch = 0; ch < channel_count; ch++) {
+                chunk_areas[ch].ptr = areas[ch].ptr + offset * areas[ch].step;
+                chunk_areas[ch].step = areas[ch].step;
+                ReadVisitor visitor = {
+                    chunk_areas[ch].ptr, chunk_areas[ch].step, chunk,
+                    m_convert_ptrs[ch]
+                };
+                if (!visit_reader(static_cast<SoundIoFormat>(format),
+                        visitor)) {
+                    return false;
+                }
+            }
+            process(m_convert_ptrs.data(), m_convert_ptrs.data(), chunk);
+            if (!m_dither.write(m_convert_ptrs.data(), format, chunk_areas,
+                    channel_count, chunk)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Convolver::reset()
+    {
+        // Let a running tail block finish before clearing its buffers
+        while (true) {
+            int expected = TailQueued;
+            if (m_tail_state.compare_exchange_strong(expected, TailIdle) ||
+                    expected != TailRunning) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+        m_tail_state = TailIdle;
+        m_abandoned = 0;
+        m_tail_inline = false;
+        m_stalled = false;
+        for (Channel& state : m_channels) {
+            std::fill(state.input.begin(), state.input.end(), 0.0f);
+            std::fill(state.early_output.begin(), state.early_output.end(),
+                0.0f);
+            std::fill(state.tail_input.begin(), state.tail_input.end(), 0.0f);
+            std::fill(state.tail_output.begin(), state.tail_output.end(),
+                0.0f);
+            state.early.reset();
+            state.late.reset();
+        }
+        m_head_pos = 0;
+        m_tail_pos = 0;
+        m_dither.reset();
+    }
+
+    void Convolver::start()
+    {
+        if (m_running) {
+            return;
+        }
+        m_running = true;
+        m_worker = std::thread(&Convolver::run, this);
+    }
+
+    void Convolver::stop()
+    {
+        m_running = false;
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+    }
+
+    // Getters/Setters
+
+    int Convolver::get_channel_count() const
+    {
+        return static_cast<int>(m_channels.size());
+    }
+
+    int Convolver::get_head_size() const
+    {
+        return m_head_size;
+    }
+
+    int Convolver::get_tail_size() const
+    {
+        return m_tail_size;
+    }
+
+    unsigned Convolver::get_late_blocks() const
+    {
+        return m_late_blocks.load(std::memory_order_relaxed);
+    }
+
+    void Convolver::advance(int frame_count)
+    {
+        m_head_pos += frame_count;
+        m_tail_pos += frame_count;
+        if (m_head_pos == m_head_size) {
+            for (Channel& state : m_channels) {
+                state.early.process(state.input.data(),
+                    state.early_output.data());
+                std::copy(state.input.begin() + m_head_size, state.input.end(),
+                    state.input.begin());
+            }
+            m_head_pos = 0;
+        }
+        if (m_tail_pos == m_tail_size) {
+            finish_tail();
+            start_tail();
+            m_tail_pos = 0;
+        }
+    }
+
+    void Convolver::finish_tail()
+    {
+        if (m_abandoned > 0) {
+            if (m_tail_state.load(std::memory_order_acquire) != TailDone) {
+                m_abandoned++;
+            } else {
+                // Its result is stale, drop it
+                m_tail_state.store(TailIdle, std::memory_order_relaxed);
+                m_abandoned = 0;
+            }
+        }
+
+        if (m_stalled) {
+            m_late_blocks.fetch_add(1, std::memory_order_relaxed);
+            for (Channel& state : m_channels) {
+                std::fill(state.tail_output.begin(), state.tail_output.end(),
+                    0.0f);
+                if (m_abandoned == 0) {
+                    // Restart from silence, the delay line missed pushes
+                    state.late.reset();
+                }
+            }
+            m_stalled = m_abandoned > 0;
+            return;
+        }
+        if (m_tail_inline) {
+            m_tail_inline = false;
+            m_late_blocks.fetch_add(1, std::memory_order_relaxed);
+            compute_tail();
+            return;
+        }
+
+        int expected = TailQueued;
+        if (m_tail_state.compare_exchange_strong(expected, TailIdle,
+                std::memory_order_acquire)) {
+            if (m_running) {
+                m_late_blocks.fetch_add(1, std::memory_order_relaxed);
+            }
+            compute_tail();
+        } else if (expected == TailRunning) {
+            // Never wait for the worker, it finishes into tail_result
+            // while this block is computed here
+            m_late_blocks.fetch_add(1, std::memory_order_relaxed);
+            m_abandoned = 1;
+            compute_tail();
+        } else if (expected == TailDone) {
+            for (Channel& state : m_channels) {
+                state.tail_output.swap(state.tail_result);
+            }
+            m_tail_state.store(TailIdle, std::memory_order_relaxed);
+        }
+    }
+
+    void Convolver::start_tail()
+    {
+        // One spare slot lets the worker run one block late. After that
+        // the next push overwrites a slot it still reads, so the tail is
+        // dropped until it returns.
+        if (m_abandoned > 1) {
+            m_stalled = true;
+        }
+        for (Channel& state : m_channels) {
+            if (!m_stalled) {
+                state.late.push(state.tail_input.data());
+            }
+            std::copy(state.tail_input.begin() + m_tail_size,
+                state.tail_input.end(), state.tail_input.begin());
+        }
+        if (m_stalled) {
+            return;
+        }
+        if (m_abandoned > 0) {
+            m_tail_inline = true;
+            return;
+        }
+        m_tail_slot = m_channels[0].late.delay_pos;
+        m_tail_state.store(TailQueued, std::memory_order_release);
+    }
+
+    void Convolver::compute_tail()
+    {
+        for (Channel& state : m_channels) {
+            state.late.convolve(state.late.delay_pos, state.late.scratch,
+                state.tail_spare.data());
+            state.tail_output.swap(state.tail_spare);
+        }
+    }
+
+    void Convolver::run()
+    {
+        ThreadTuner::apply_worker();
+        while (m_running) {
+            int expected = TailQueued;
+            if (!m_tail_state.compare_exchange_strong(expected, TailRunning,
+                    std::memory_order_acquire)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            for (Channel& state : m_channels) {
+                state.late.convolve(m_tail_slot, state.worker,
+                    state.tail_result.data());
+            }
+            m_tail_state.store(TailDone, std::memory_order_release);
+        }
+    }
+}
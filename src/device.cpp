@@ -26,7 +26,9 @@ namespace sio
     {
         m_device = other.m_device;
         m_context = other.m_context;
-        soundio_device_ref(m_device);
+        if (m_device != nullptr) {
+            soundio_device_ref(m_device);
+        }
     }
 
     Device& Device::operator=(const Device& other)
@@ -39,7 +41,9 @@ namespace sio
         }
         m_device = other.m_device;
         m_context = other.m_context;
-        soundio_device_ref(m_device);
+        if (m_device != nullptr) {
+            soundio_device_ref(m_device);
+        }
         return *this;
     }
 
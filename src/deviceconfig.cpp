@@ -0,0 +1,296 @@
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/deviceconfig.h"
+
+namespace sio
+{
+    static const char* config_header = "soundiopp-device-config 1";
+
+    static int device_index(Device& device, DeviceAimId aim)
+    {
+        Context* context = device.get_context();
+        bool input = aim == DeviceAimId::Input;
+        int count = input ? context->input_device_count() :
+            context->output_device_count();
+        for (int i = 0; i < count; i++) {
+            SoundIoDevice* candidate = input ?
+                soundio_get_input_device(*context, i) :
+                soundio_get_output_device(*context, i);
+            if (candidate == nullptr) {
+                continue;
+            }
+            bool match = soundio_device_equal(candidate, device);
+            soundio_device_unref(candidate);
+            if (match) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    static ChannelLayout make_layout(const std::vector<ChannelId>& channels)
+    {
+        ChannelLayout layout;
+        layout.set_channels(channels);
+        // Points the name at libsoundio's static one when there is one
+        layout.detect_builtin();
+        return layout;
+    }
+
+    DeviceConfigCache::DeviceConfigCache(const std::string& path)
+    {
+        m_path = path;
+    }
+
+    bool DeviceConfigCache::load()
+    {
+        std::ifstream file(m_path.c_str());
+        std::string line;
+        if (!std::getline(file, line) || line != config_header) {
+            return false;
+        }
+
+        std::map<std::string, StreamConfig> configs;
+        StreamConfig* config = nullptr;
+        while (std::getline(file, line)) {
+            if (line.empty()) {
+                continue;
+            }
+            if (line[0] == '[' && line[line.size() - 1] == ']') {
+                config = &configs[line.substr(1, line.size() - 2)];
+                config->backend = BackendId::None;
+                config->aim = DeviceAimId::Output;
+                config->is_raw = false;
+                config->device_index = -1;
+                config->format = FormatId::Invalid;
+                config->sample_rate = 0;
+                config->software_latency = 0.0;
+                continue;
+            }
+            size_t separator = line.find('=');
+            if (config == nullptr || separator == std::string::npos) {
+                return false;
+            }
+            std::string name = line.substr(0, separator);
+            std::string value = line.substr(separator + 1);
+            std::istringstream in(value);
+            int number = 0;
+            if (name == "device") {
+                config->device_id = value;
+            } else if (name == "channels") {
+                config->channels.clear();
+                while (in >> number) {
+                    config->channels.push_back(static_cast<ChannelId>(number));
+                }
+            } else if (name == "software_latency") {
+                in >> config->software_latency;
+            } else {
+                in >> number;
+                if (name == "backend") {
+                    config->backend = static_cast<BackendId>(number);
+                } else if (name == "aim") {
+                    config->aim = static_cast<DeviceAimId>(number);
+                } else if (name == "raw") {
+                    config->is_raw = number != 0;
+                } else if (name == "index") {
+                    config->device_index = number;
+                } else if (name == "format") {
+                    config->format = static_cast<FormatId>(number);
+                } else if (name == "sample_rate") {
+                    config->sample_rate = number;
+                }
+            }
+        }
+        m_configs.swap(configs);
+        return true;
+    }
+
+    void DeviceConfigCache::save() const
+    {
+        // Written aside and renamed so a crash never leaves half a file
+        std::string temp_path = m_path + ".tmp";
+        {
+            std::ofstream file(temp_path.c_str());
+            if (!file) {
+                throw soundio_error(ErrorId::OpeningDevice);
+            }
+            file << config_header << '\n' << std::setprecision(17);
+            for (const auto& entry : m_configs) {
+                const StreamConfig& config = entry.second;
+                file << '\n' << '[' << entry.first << "]\n"
+                    << "backend=" << static_cast<int>(config.backend) << '\n'
+                    << "aim=" << static_cast<int>(config.aim) << '\n'
+                    << "device=" << config.device_id << '\n'
+                    << "raw=" << (config.is_raw ? 1 : 0) << '\n'
+                    << "index=" << config.device_index << '\n'
+                    << "format=" << static_cast<int>(config.format) << '\n'
+                    << "sample_rate=" << config.sample_rate << '\n'
+                    << "channels=";
+                for (size_t i = 0; i < config.channels.size(); i++) {
+                    file << (i == 0 ? "" : " ")
+                        << static_cast<int>(config.channels[i]);
+                }
+                file << '\n'
+                    << "software_latency=" << config.software_latency << '\n';
+            }
+            if (!file) {
+                throw soundio_error(ErrorId::Streaming);
+            }
+        }
+        if (std::rename(temp_path.c_str(), m_path.c_str()) != 0) {
+            std::remove(temp_path.c_str());
+            throw soundio_error(ErrorId::OpeningDevice);
+        }
+    }
+
+    bool DeviceConfigCache::get(const std::string& key,
+        StreamConfig& config) const
+    {
+        auto it = m_configs.find(key);
+        if (it == m_configs.end()) {
+            return false;
+        }
+        config = it->second;
+        return true;
+    }
+
+    void DeviceConfigCache::set(const std::string& key,
+        const StreamConfig& config)
+    {
+        m_configs[key] = config;
+    }
+
+    void DeviceConfigCache::remove(const std::string& key)
+    {
+        m_configs.erase(key);
+    }
+
+    void DeviceConfigCache::store(const std::string& key,
+        OutStream& outstream)
+    {
+        Device* device = outstream.get_device();
+        if (device == nullptr) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        StreamConfig config;
+        config.backend = device->get_context()->get_current_backend();
+        config.aim = DeviceAimId::Output;
+        config.device_id = device->get_id();
+        config.is_raw = device->is_raw();
+        config.device_index = device_index(*device, DeviceAimId::Output);
+        config.format = outstream.get_format();
+        config.sample_rate = outstream.get_sample_rate();
+        config.channels = outstream.get_layout().get_channels();
+        config.software_latency = outstream.get_software_latency();
+        set(key, config);
+    }
+
+    void DeviceConfigCache::store(const std::string& key, InStream& instream)
+    {
+        Device* device = instream.get_device();
+        if (device == nullptr) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        StreamConfig config;
+        config.backend = device->get_context()->get_current_backend();
+        config.aim = DeviceAimId::Input;
+        config.device_id = device->get_id();
+        config.is_raw = device->is_raw();
+        config.device_index = device_index(*device, DeviceAimId::Input);
+        config.format = instream.get_format();
+        config.sample_rate = instream.get_sample_rate();
+        config.channels = instream.get_layout().get_channels();
+        config.software_latency = instream.get_software_latency();
+        set(key, config);
+    }
+
+    bool DeviceConfigCache::open_outstream(Context& context,
+        const std::string& key, Device& device, OutStream& outstream)
+    {
+        StreamConfig config;
+        Device found;
+        if (!get(key, config) ||
+                !find_device(context, config, DeviceAimId::Output, found)) {
+            return false;
+        }
+        // Streams point at their Device, so open on the caller's and put
+        // the old one back if the stored settings no longer work
+        Device previous = device;
+        device = found;
+        OutStream stream = device.create_outstream();
+        stream.set_format(config.format);
+        stream.set_sample_rate(config.sample_rate);
+        stream.set_layout(make_layout(config.channels));
+        stream.set_software_latency(config.software_latency);
+        try {
+            stream.open();
+        } catch (const soundio_error&) {
+            device = previous;
+            return false;
+        }
+        outstream = std::move(stream);
+        return true;
+    }
+
+    bool DeviceConfigCache::open_instream(Context& context,
+        const std::string& key, Device& device, InStream& instream)
+    {
+        StreamConfig config;
+        Device found;
+        if (!get(key, config) ||
+                !find_device(context, config, DeviceAimId::Input, found)) {
+            return false;
+        }
+        // Streams point at their Device, so open on the caller's and put
+        // the old one back if the stored settings no longer work
+        Device previous = device;
+        device = found;
+        InStream stream = device.create_instream();
+        stream.set_format(config.format);
+        stream.set_sample_rate(config.sample_rate);
+        stream.set_layout(make_layout(config.channels));
+        stream.set_software_latency(config.software_latency);
+        try {
+            stream.open();
+        } catch (const soundio_error&) {
+            device = previous;
+            return false;
+        }
+        instream = std::move(stream);
+        return true;
+    }
+
+    // Getters/Setters
+
+    std::string DeviceConfigCache::get_path() const
+    {
+        return m_path;
+    }
+
+    bool DeviceConfigCache::find_device(Context& context,
+        const StreamConfig& config, DeviceAimId aim, Device& device)
+    {
+        if (config.aim != aim || config.backend != context.get_current_backend()) {
+            return false;
+        }
+        DeviceEntry entry;
+        entry.id = config.device_id;
+        entry.aim = aim;
+        entry.is_raw = config.is_raw;
+        entry.index = config.device_index;
+        entry.probe_error = ErrorId::None;
+        try {
+            device = context.get_device(entry);
+        } catch (const soundio_error&) {
+            return false;
+        }
+        return true;
+    }
+}
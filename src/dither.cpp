@@ -0,0 +1,159 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/dither.h"
+#include "convert.h"
+
+namespace sio
+{
+    // Uniform in [-0.5, 0.5) from one xorshift32 step
+    static inline float next_uniform(uint32_t& state)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return static_cast<int32_t>(state) * (1.0f / 4294967296.0f);
+    }
+
+    // The mode is a template parameter so each loop compiles without
+    // per-sample branches
+    template<typename Writer, DitherMode Mode>
+    static void quantize(const float* input, char* ptr, int step,
+        int frame_count, float scale, float max, uint32_t& random,
+        float* error)
+    {
+        float error1 = error[0];
+        float error2 = error[1];
+        for (int i = 0; i < frame_count; i++) {
+            float value = input[i] * scale;
+            if (Mode == DitherMode::NoiseShaped) {
+                // Error transfer function (1 - z^-1)^2
+                value -= 2.0f * error1 - error2;
+            }
+            float dithered = value;
+            if (Mode != DitherMode::None) {
+                dithered += next_uniform(random) + next_uniform(random);
+            }
+            float rounded = std::floor(dithered + 0.5f);
+            if (Mode == DitherMode::NoiseShaped) {
+                // Taken before clipping so overloads can't destabilise
+                // the filter
+                error2 = error1;
+                error1 = rounded - value;
+            }
+            if (rounded < -scale) {
+                rounded = -scale;
+            } else if (rounded > max) {
+                rounded = max;
+            }
+            Writer::write(ptr, static_cast<int32_t>(rounded));
+            ptr += step;
+        }
+        error[0] = error1;
+        error[1] = error2;
+    }
+
+    struct DitherVisitor
+    {
+        Dither* dither;
+        const float* input;
+        char* ptr;
+        int step;
+        int frame_count;
+        int channel;
+
+        template<typename Writer>
+        void apply(float scale, float max)
+        {
+            uint32_t& random = dither->m_random[channel];
+            float* error = dither->m_error[channel];
+            switch (dither->m_mode) {
+            case DitherMode::None:
+                quantize<Writer, DitherMode::None>(input, ptr, step,
+                    frame_count, scale, max, random, error);
+                break;
+            case DitherMode::Tpdf:
+                quantize<Writer, DitherMode::Tpdf>(input, ptr, step,
+                    frame_count, scale, max, random, error);
+                break;
+            case DitherMode::NoiseShaped:
+                quantize<Writer, DitherMode::NoiseShaped>(input, ptr, step,
+                    frame_count, scale, max, random, error);
+                break;
+            }
+        }
+    };
+
+    template<typename Sample>
+    static void copy_float(const float* input, char* ptr, int step,
+        int frame_count)
+    {
+        for (int i = 0; i < frame_count; i++) {
+            Sample sample = static_cast<Sample>(input[i]);
+            std::memcpy(ptr, &sample, sizeof(Sample));
+            ptr += step;
+        }
+    }
+
+    Dither::Dither(DitherMode mode, uint32_t seed)
+    {
+        m_mode = mode;
+        m_seed = seed;
+        reset();
+    }
+
+    bool Dither::write(const float* const* channels, FormatId format,
+        const ChannelArea* areas, int channel_count, int frame_count)
+    {
+        if (channel_count > SOUNDIO_MAX_CHANNELS) {
+            channel_count = SOUNDIO_MAX_CHANNELS;
+        }
+        SoundIoFormat soundio_format = static_cast<SoundIoFormat>(format);
+
+        for (int ch = 0; ch < channel_count; ch++) {
+            if (soundio_format == SoundIoFormatFloat32NE) {
+                copy_float<float>(channels[ch], areas[ch].ptr,
+                    areas[ch].step, frame_count);
+                continue;
+            }
+            if (soundio_format == SoundIoFormatFloat64NE) {
+                copy_float<double>(channels[ch], areas[ch].ptr,
+                    areas[ch].step, frame_count);
+                continue;
+            }
+            DitherVisitor visitor = {
+                this, channels[ch], areas[ch].ptr, areas[ch].step,
+                frame_count, ch
+            };
+            if (!visit_writer(soundio_format, visitor)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Dither::reset()
+    {
+        for (int ch = 0; ch < SOUNDIO_MAX_CHANNELS; ch++) {
+            // Decorrelate the channels, xorshift must never be seeded with 0
+            uint32_t state = (m_seed + ch) * 2654435761u;
+            m_random[ch] = state != 0 ? state : 1;
+            m_error[ch][0] = 0.0f;
+            m_error[ch][1] = 0.0f;
+        }
+    }
+
+    // Getters/Setters
+
+    DitherMode Dither::get_mode() const
+    {
+        return m_mode;
+    }
+
+    void Dither::set_mode(DitherMode mode)
+    {
+        m_mode = mode;
+    }
+}
@@ -0,0 +1,128 @@
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+
+namespace sio
+{
+    Driver::~Driver()
+    {
+    }
+
+    void Driver::open(OutStream* outstream)
+    {
+        (void)outstream;
+    }
+
+    void Driver::close(OutStream* outstream)
+    {
+        (void)outstream;
+    }
+
+    void Driver::start(OutStream* outstream)
+    {
+        (void)outstream;
+    }
+
+    void Driver::pause(OutStream* outstream, bool paused)
+    {
+        (void)outstream;
+        (void)paused;
+    }
+
+    void Driver::clear_buffer(OutStream* outstream)
+    {
+        (void)outstream;
+    }
+
+    ErrorId Driver::begin_write(OutStream* outstream,
+        ChannelArea*& areas, int& frame_count) noexcept
+    {
+        (void)outstream;
+        (void)areas;
+        (void)frame_count;
+        return ErrorId::IncompatibleBackend;
+    }
+
+    ErrorId Driver::end_write(OutStream* outstream) noexcept
+    {
+        (void)outstream;
+        return ErrorId::IncompatibleBackend;
+    }
+
+    double Driver::get_latency(OutStream* outstream)
+    {
+        (void)outstream;
+        return 0.0;
+    }
+
+    void Driver::open(InStream* instream)
+    {
+        (void)instream;
+    }
+
+    void Driver::close(InStream* instream)
+    {
+        (void)instream;
+    }
+
+    void Driver::start(InStream* instream)
+    {
+        (void)instream;
+    }
+
+    void Driver::pause(InStream* instream, bool paused)
+    {
+        (void)instream;
+        (void)paused;
+    }
+
+    ErrorId Driver::begin_read(InStream* instream,
+        ChannelArea*& areas, int& frame_count) noexcept
+    {
+        (void)instream;
+        (void)areas;
+        (void)frame_count;
+        return ErrorId::IncompatibleBackend;
+    }
+
+    ErrorId Driver::end_read(InStream* instream) noexcept
+    {
+        (void)instream;
+        return ErrorId::IncompatibleBackend;
+    }
+
+    double Driver::get_latency(InStream* instream)
+    {
+        (void)instream;
+        return 0.0;
+    }
+
+    void Driver::write_callback(SoundIoOutStream* stream,
+        int frame_count_min, int frame_count_max)
+    {
+        if (stream->write_callback != nullptr) {
+            stream->write_callback(stream, frame_count_min, frame_count_max);
+        }
+    }
+
+    void Driver::underflow_callback(SoundIoOutStream* stream)
+    {
+        if (stream->underflow_callback != nullptr) {
+            stream->underflow_callback(stream);
+        }
+    }
+
+    void Driver::read_callback(SoundIoInStream* stream,
+        int frame_count_min, int frame_count_max)
+    {
+        if (stream->read_callback != nullptr) {
+            stream->read_callback(stream, frame_count_min, frame_count_max);
+        }
+    }
+
+    void Driver::overflow_callback(SoundIoInStream* stream)
+    {
+        if (stream->overflow_callback != nullptr) {
+            stream->overflow_callback(stream);
+        }
+    }
+}
@@ -0,0 +1,117 @@
+#include <cmath>
+#include <complex>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/fft.h"
+
+namespace sio
+{
+    static const double pi = 3.14159265358979323846;
+
+    Fft::Fft(int size)
+    {
+        if (size < 4 || (size & (size - 1)) != 0) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        m_size = size;
+        int half = size / 2;
+
+        int bits = 0;
+        while ((1 << bits) < half) {
+            bits++;
+        }
+        m_bit_reverse.resize(half);
+        for (int i = 0; i < half; i++) {
+            int reversed = 0;
+            for (int b = 0; b < bits; b++) {
+                reversed |= ((i >> b) & 1) << (bits - 1 - b);
+            }
+            m_bit_reverse[i] = reversed;
+        }
+
+        m_twiddles.resize(half / 2);
+        for (int i = 0; i < half / 2; i++) {
+            double angle = -2.0 * pi * i / half;
+            m_twiddles[i] = std::complex<float>(
+                static_cast<float>(std::cos(angle)),
+                static_cast<float>(std::sin(angle)));
+        }
+        m_split_twiddles.resize(half + 1);
+        for (int i = 0; i <= half; i++) {
+            double angle = -2.0 * pi * i / size;
+            m_split_twiddles[i] = std::complex<float>(
+                static_cast<float>(std::cos(angle)),
+                static_cast<float>(std::sin(angle)));
+        }
+        m_work.resize(half);
+    }
+
+    int Fft::get_size() const
+    {
+        return m_size;
+    }
+
+    void Fft::forward(const float* input, std::complex<float>* output)
+    {
+        int half = m_size / 2;
+        // Pack even samples into the real and odd into the imaginary part
+        for (int i = 0; i < half; i++) {
+            m_work[m_bit_reverse[i]] =
+                std::complex<float>(input[2 * i], input[2 * i + 1]);
+        }
+        transform(m_work.data(), false);
+
+        const std::complex<float> minus_half_i(0.0f, -0.5f);
+        for (int k = 0; k <= half; k++) {
+            std::complex<float> z = m_work[k % half];
+            std::complex<float> z_mirror = std::conj(m_work[(half - k) % half]);
+            std::complex<float> even = 0.5f * (z + z_mirror);
+            std::complex<float> odd = minus_half_i * (z - z_mirror);
+            output[k] = even + m_split_twiddles[k] * odd;
+        }
+    }
+
+    void Fft::inverse(const std::complex<float>* input, float* output)
+    {
+        int half = m_size / 2;
+        const std::complex<float> i_unit(0.0f, 1.0f);
+        for (int k = 0; k < half; k++) {
+            std::complex<float> x = input[k];
+            std::complex<float> x_mirror = std::conj(input[half - k]);
+            std::complex<float> even = 0.5f * (x + x_mirror);
+            std::complex<float> odd =
+                0.5f * (x - x_mirror) * std::conj(m_split_twiddles[k]);
+            m_work[m_bit_reverse[k]] = even + i_unit * odd;
+        }
+        transform(m_work.data(), true);
+
+        float scale = 1.0f / half;
+        for (int i = 0; i < half; i++) {
+            output[2 * i] = m_work[i].real() * scale;
+            output[2 * i + 1] = m_work[i].imag() * scale;
+        }
+    }
+
+    void Fft::transform(std::complex<float>* data, bool inverse)
+    {
+        // Iterative radix-2, input is already in bit reversed order
+        int half = m_size / 2;
+        for (int length = 2; length <= half; length <<= 1) {
+            int span = length / 2;
+            int stride = half / length;
+            for (int start = 0; start < half; start += length) {
+                for (int j = 0; j < span; j++) {
+                    std::complex<float> twiddle = m_twiddles[j * stride];
+                    if (inverse) {
+                        twiddle = std::conj(twiddle);
+                    }
+                    std::complex<float> a = data[start + j];
+                    std::complex<float> b = data[start + j + span] * twiddle;
+                    data[start + j] = a + b;
+                    data[start + j + span] = a - b;
+                }
+            }
+        }
+    }
+}
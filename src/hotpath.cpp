@@ -0,0 +1,6 @@
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+
+#ifndef SOUNDIOPP_INLINE
+#include "soundiopp/hotpath.h"
+#endif
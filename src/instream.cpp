@@ -2,6 +2,13 @@
 #include <functional>
 #include "soundio/soundio.h"
 #include "soundiopp/soundiopp.h"
+#include "soundiopp/meter.h"
+#include "soundiopp/analysis.h"
+#include "soundiopp/callbacktrace.h"
+#include "soundiopp/clock.h"
+#include "soundiopp/rtcheck.h"
+#include "soundiopp/threading.h"
+#include "soundiopp/trace.h"
 
 namespace sio
 {
@@ -9,6 +16,14 @@ namespace sio
     {
         m_instream = nullptr;
         m_device = nullptr;
+        m_driver = nullptr;
+        m_meter = nullptr;
+        m_tap = nullptr;
+        m_clock = nullptr;
+        m_tracer = nullptr;
+        m_thread_tuner = nullptr;
+        m_recorder = nullptr;
+        m_read_frames = 0;
         m_userdata = nullptr;
     }
 
@@ -16,20 +31,55 @@ namespace sio
     {
         m_instream = instream;
         m_device = device;
+        m_driver = nullptr;
+        m_meter = nullptr;
+        m_tap = nullptr;
+        m_clock = nullptr;
+        m_tracer = nullptr;
+        m_thread_tuner = nullptr;
+        m_recorder = nullptr;
+        m_read_frames = 0;
         m_userdata = m_instream->userdata;
         m_instream->userdata = this;
     }
 
+    InStream::InStream(Driver* driver)
+    {
+        // Not backed by libsoundio, the struct only holds the parameters
+        m_instream = new SoundIoInStream();
+        m_device = nullptr;
+        m_driver = driver;
+        m_meter = nullptr;
+        m_tap = nullptr;
+        m_clock = nullptr;
+        m_tracer = nullptr;
+        m_thread_tuner = nullptr;
+        m_recorder = nullptr;
+        m_read_frames = 0;
+        m_userdata = nullptr;
+        m_instream->userdata = this;
+    }
+
     InStream::InStream(InStream&& other)
     {
         m_instream = other.m_instream;
         m_device = other.m_device;
+        m_driver = other.m_driver;
+        m_meter = other.m_meter;
+        m_tap = other.m_tap;
+        m_clock = other.m_clock;
+        m_tracer = other.m_tracer;
+        m_thread_tuner = other.m_thread_tuner;
+        m_recorder = other.m_recorder;
+        m_read_frames = other.m_read_frames;
         m_userdata = other.m_userdata;
         m_name = other.m_name;
         m_read_callback = other.m_read_callback;
         m_overflow_callback = other.m_overflow_callback;
         m_error_callback = other.m_error_callback;
-        m_instream->userdata = this;
+        if (m_instream != nullptr) {
+            m_instream->userdata = this;
+        }
         other.m_instream = nullptr;
     }
 
@@ -38,23 +88,45 @@ namespace sio
         if (&other == this) {
             return *this;
         }
-        if (m_instream != nullptr) {
+        if (m_driver != nullptr) {
+            if (m_instream != nullptr) {
+                m_driver->close(this);
+            }
+            delete m_instream;
+        } else if (m_instream != nullptr) {
             soundio_instream_destroy(m_instream);
         }
         m_instream = other.m_instream;
         m_device = other.m_device;
+        m_driver = other.m_driver;
+        m_meter = other.m_meter;
+        m_tap = other.m_tap;
+        m_clock = other.m_clock;
+        m_tracer = other.m_tracer;
+        m_thread_tuner = other.m_thread_tuner;
+        m_recorder = other.m_recorder;
+        m_read_frames = other.m_read_frames;
         m_userdata = other.m_userdata;
         m_name = other.m_name;
         m_read_callback = other.m_read_callback;
         m_overflow_callback = other.m_overflow_callback;
         m_error_callback = other.m_error_callback;
-        m_instream->userdata = this;
+        if (m_instream != nullptr) {
+            m_instream->userdata = this;
+        }
         other.m_instream = nullptr;
         return *this;
     }
 
     InStream::~InStream()
     {
+        if (m_driver != nullptr) {
+            if (m_instream != nullptr) {
+                m_driver->close(this);
+            }
+            delete m_instream;
+            return;
+        }
         soundio_instream_destroy(m_instream);
     }
 
@@ -70,6 +142,27 @@ namespace sio
 
     void InStream::open()
     {
+        if (m_driver != nullptr) {
+            // Same defaults soundio_instream_open applies
+            if (m_instream->format == SoundIoFormatInvalid) {
+                m_instream->format = SoundIoFormatFloat32NE;
+            }
+            if (m_instream->sample_rate == 0) {
+                m_instream->sample_rate = 48000;
+            }
+            if (m_instream->layout.channel_count == 0) {
+                m_instream->layout = ChannelLayout::get_default(2);
+            }
+            if (m_instream->name == nullptr) {
+                m_instream->name = "SoundIoInStream";
+            }
+            m_instream->bytes_per_sample =
+                soundio_get_bytes_per_sample(m_instream->format);
+            m_instream->bytes_per_frame = soundio_get_bytes_per_frame(
+                m_instream->format, m_instream->layout.channel_count);
+            m_driver->open(this);
+            return;
+        }
         WRAP_SOUNDIO_ERROR(soundio_instream_open(m_instream));
         if (m_instream->layout_error) {
             throw soundio_error(m_instream->layout_error);
@@ -78,29 +171,44 @@ namespace sio
 
     void InStream::start()
     {
+        if (m_driver != nullptr) {
+            m_driver->start(this);
+            return;
+        }
         WRAP_SOUNDIO_ERROR(soundio_instream_start(m_instream));
     }
 
     int InStream::begin_read(ChannelArea*& areas, int frame_count)
     {
-        WRAP_SOUNDIO_ERROR(soundio_instream_begin_read(
-            m_instream, &areas, &frame_count));
-        // frame_count gets modified by begin_read
+        ErrorId err = try_begin_read(areas, frame_count);
+        if (err != ErrorId::None) {
+            throw soundio_error(err);
+        }
         return frame_count;
     }
 
     void InStream::end_read()
     {
-        WRAP_SOUNDIO_ERROR(soundio_instream_end_read(m_instream));
+        ErrorId err = try_end_read();
+        if (err != ErrorId::None) {
+            throw soundio_error(err);
+        }
     }
 
     void InStream::pause(bool paused)
     {
+        if (m_driver != nullptr) {
+            m_driver->pause(this, paused);
+            return;
+        }
         WRAP_SOUNDIO_ERROR(soundio_instream_pause(m_instream, paused));
     }
 
     double InStream::get_latency()
     {
+        if (m_driver != nullptr) {
+            return m_driver->get_latency(this);
+        }
         double latency;
         WRAP_SOUNDIO_ERROR(soundio_instream_get_latency(
             m_instream, &latency));
@@ -109,26 +217,11 @@ namespace sio
 
     // Getters/Setters
 
-    Device* InStream::get_device()
-    {
-        return m_device;
-    }
-
-    FormatId InStream::get_format() const
-    {
-        return static_cast<FormatId>(m_instream->format);
-    }
-
     void InStream::set_format(FormatId format)
     {
         m_instream->format = static_cast<SoundIoFormat>(format);
     }
 
-    int InStream::get_sample_rate() const
-    {
-        return m_instream->sample_rate;
-    }
-
     void InStream::set_sample_rate(int sample_rate)
     {
         m_instream->sample_rate = sample_rate;
@@ -154,11 +247,6 @@ namespace sio
         m_instream->software_latency = software_latency;
     }
 
-    void* InStream::get_userdata()
-    {
-        return m_userdata;
-    }
-
     void InStream::set_userdata(void* userdata)
     {
         m_userdata = userdata;
@@ -185,14 +273,64 @@ namespace sio
         m_instream->non_terminal_hint = hint;
     }
 
-    int InStream::get_bytes_per_frame() const
+    Meter* InStream::get_meter()
+    {
+        return m_meter;
+    }
+
+    void InStream::set_meter(Meter* meter)
+    {
+        m_meter = meter;
+    }
+
+    AnalysisTap* InStream::get_tap()
+    {
+        return m_tap;
+    }
+
+    void InStream::set_tap(AnalysisTap* tap)
+    {
+        m_tap = tap;
+    }
+
+    StreamClock* InStream::get_clock()
+    {
+        return m_clock;
+    }
+
+    void InStream::set_clock(StreamClock* clock)
+    {
+        m_clock = clock;
+    }
+
+    Tracer* InStream::get_tracer()
+    {
+        return m_tracer;
+    }
+
+    void InStream::set_tracer(Tracer* tracer)
+    {
+        m_tracer = tracer;
+    }
+
+    ThreadTuner* InStream::get_thread_tuner()
     {
-        return m_instream->bytes_per_frame;
+        return m_thread_tuner;
     }
 
-    int InStream::get_bytes_per_sample() const
+    void InStream::set_thread_tuner(ThreadTuner* thread_tuner)
     {
-        return m_instream->bytes_per_sample;
+        m_thread_tuner = thread_tuner;
+    }
+
+    CallbackRecorder* InStream::get_recorder()
+    {
+        return m_recorder;
+    }
+
+    void InStream::set_recorder(CallbackRecorder* recorder)
+    {
+        m_recorder = recorder;
     }
 
     std::function<void(InStream*, int, int)> InStream::get_read_callback()
@@ -235,20 +373,49 @@ namespace sio
         SoundIoInStream* stream, int frame_count_min, int frame_count_max)
     {
         InStream* instream = static_cast<InStream*>(stream->userdata);
-        auto cb = instream->get_read_callback();
-        cb(instream, frame_count_min, frame_count_max);
+        RtScope realtime;
+        if (instream->m_thread_tuner != nullptr) {
+            instream->m_thread_tuner->update();
+        }
+        TraceScope trace(instream->m_tracer, "read_callback");
+        if (instream->m_recorder != nullptr) {
+            instream->m_recorder->callback(
+                instream, frame_count_min, frame_count_max);
+        }
+        if (instream->m_clock != nullptr) {
+            // The next frame to read was captured one latency ago
+            double latency = 0.0;
+            if (instream->m_driver != nullptr) {
+                latency = instream->m_driver->get_latency(instream);
+            } else {
+                soundio_instream_get_latency(stream, &latency);
+            }
+            instream->m_clock->update(
+                StreamClock::now() - latency, stream->sample_rate);
+        }
+        // Called directly, a copy of the std::function could allocate
+        instream->m_read_callback(instream, frame_count_min, frame_count_max);
     }
 
     void InStream::overflow_callback_wrapper(SoundIoInStream* stream)
     {
         InStream* instream = static_cast<InStream*>(stream->userdata);
-        auto cb = instream->get_overflow_callback();
-        cb(instream);
+        RtScope realtime;
+        if (instream->m_tracer != nullptr) {
+            instream->m_tracer->instant("overflow");
+        }
+        if (instream->m_recorder != nullptr) {
+            instream->m_recorder->xrun();
+        }
+        instream->m_overflow_callback(instream);
     }
 
     void InStream::error_callback_wrapper(SoundIoInStream* stream, int err)
     {
         InStream* instream = static_cast<InStream*>(stream->userdata);
+        if (instream->m_tracer != nullptr) {
+            instream->m_tracer->instant("stream_error");
+        }
         auto cb = instream->get_error_callback();
         cb(instream, err);
     }
@@ -0,0 +1,236 @@
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/latencytuner.h"
+
+namespace sio
+{
+    static const size_t max_history = 256;
+
+    LatencyTuner::LatencyTuner()
+    {
+        m_underflow_count = 0;
+        m_min_margin_frames = INT_MAX;
+        m_sample_rate = 0;
+        m_start_time = std::chrono::steady_clock::now();
+        m_latency = 0.0;
+        m_latency_min = 0.0;
+        m_latency_max = 0.0;
+        m_unsafe_latency = 0.0;
+        m_increase_factor = 1.5;
+        m_decrease_factor = 0.85;
+        m_stable_updates = 10;
+        m_clean_updates = 0;
+        m_margin_threshold = 0.25;
+    }
+
+    void LatencyTuner::attach(OutStream* outstream)
+    {
+        Device* device = outstream->get_device();
+        if (m_latency_max == 0.0 && device != nullptr) {
+            set_latency_range(
+                device->get_software_latency_min(),
+                device->get_software_latency_max());
+        }
+        if (m_latency == 0.0) {
+            m_latency = outstream->get_software_latency();
+        }
+        if (m_latency == 0.0 && device != nullptr) {
+            m_latency = device->get_software_latency_current();
+        }
+
+        m_underflow_count = 0;
+        m_min_margin_frames = INT_MAX;
+        m_sample_rate = outstream->get_sample_rate();
+        m_clean_updates = 0;
+
+        auto write_callback = outstream->get_write_callback();
+        outstream->set_write_callback(
+            [this, write_callback](
+                OutStream* stream, int frame_count_min, int frame_count_max)
+            {
+                record_margin(stream, frame_count_max);
+                write_callback(stream, frame_count_min, frame_count_max);
+            }
+        );
+        auto underflow_callback = outstream->get_underflow_callback();
+        outstream->set_underflow_callback(
+            [this, underflow_callback](OutStream* stream)
+            {
+                m_underflow_count.fetch_add(1, std::memory_order_relaxed);
+                if (underflow_callback) {
+                    underflow_callback(stream);
+                }
+            }
+        );
+    }
+
+    bool LatencyTuner::update()
+    {
+        int underflow_count = m_underflow_count.exchange(0);
+        int margin_frames = m_min_margin_frames.exchange(INT_MAX);
+        int sample_rate = m_sample_rate.load();
+        double min_margin = m_latency;
+        if (margin_frames != INT_MAX && sample_rate > 0) {
+            min_margin = static_cast<double>(margin_frames) / sample_rate;
+        }
+
+        if (underflow_count > 0) {
+            m_clean_updates = 0;
+            if (m_latency > m_unsafe_latency) {
+                m_unsafe_latency = m_latency;
+            }
+            double new_latency = m_latency * m_increase_factor;
+            if (m_latency_max > 0.0 && new_latency > m_latency_max) {
+                new_latency = m_latency_max;
+            }
+            if (new_latency == m_latency) {
+                return false;
+            }
+            add_decision(new_latency, TuneReason::Underflow,
+                underflow_count, min_margin);
+            return true;
+        }
+
+        if (min_margin < m_latency * m_margin_threshold) {
+            // Running close to the edge, not a good time to lower
+            m_clean_updates = 0;
+            return false;
+        }
+        if (++m_clean_updates < m_stable_updates) {
+            return false;
+        }
+        m_clean_updates = 0;
+
+        double new_latency = m_latency * m_decrease_factor;
+        if (new_latency < m_latency_min) {
+            new_latency = m_latency_min;
+        }
+        // Never go back to a latency that has underflowed before
+        if (new_latency <= m_unsafe_latency || new_latency == m_latency) {
+            return false;
+        }
+        add_decision(new_latency, TuneReason::Headroom,
+            underflow_count, min_margin);
+        return true;
+    }
+
+    void LatencyTuner::apply(OutStream* outstream)
+    {
+        outstream->set_software_latency(m_latency);
+        attach(outstream);
+    }
+
+    void LatencyTuner::reset()
+    {
+        m_underflow_count = 0;
+        m_min_margin_frames = INT_MAX;
+        m_unsafe_latency = 0.0;
+        m_clean_updates = 0;
+        m_history.clear();
+    }
+
+    // Getters/Setters
+
+    double LatencyTuner::get_software_latency() const
+    {
+        return m_latency;
+    }
+
+    void LatencyTuner::set_software_latency(double software_latency)
+    {
+        m_latency = software_latency;
+    }
+
+    double LatencyTuner::get_latency_min() const
+    {
+        return m_latency_min;
+    }
+
+    double LatencyTuner::get_latency_max() const
+    {
+        return m_latency_max;
+    }
+
+    void LatencyTuner::set_latency_range(double latency_min, double latency_max)
+    {
+        m_latency_min = latency_min;
+        m_latency_max = latency_max;
+    }
+
+    double LatencyTuner::get_increase_factor() const
+    {
+        return m_increase_factor;
+    }
+
+    void LatencyTuner::set_increase_factor(double factor)
+    {
+        m_increase_factor = factor;
+    }
+
+    double LatencyTuner::get_decrease_factor() const
+    {
+        return m_decrease_factor;
+    }
+
+    void LatencyTuner::set_decrease_factor(double factor)
+    {
+        m_decrease_factor = factor;
+    }
+
+    int LatencyTuner::get_stable_updates() const
+    {
+        return m_stable_updates;
+    }
+
+    void LatencyTuner::set_stable_updates(int updates)
+    {
+        m_stable_updates = updates;
+    }
+
+    double LatencyTuner::get_margin_threshold() const
+    {
+        return m_margin_threshold;
+    }
+
+    void LatencyTuner::set_margin_threshold(double threshold)
+    {
+        m_margin_threshold = threshold;
+    }
+
+    std::vector<LatencyDecision> LatencyTuner::get_history() const
+    {
+        return m_history;
+    }
+
+    void LatencyTuner::record_margin(OutStream* outstream, int frame_count_max)
+    {
+        // Whatever the backend doesn't ask for is still queued for playback
+        int buffer_frames = static_cast<int>(
+            outstream->get_software_latency() * outstream->get_sample_rate());
+        int margin = buffer_frames - frame_count_max;
+        int current = m_min_margin_frames.load(std::memory_order_relaxed);
+        while (margin < current && !m_min_margin_frames.compare_exchange_weak(
+                current, margin, std::memory_order_relaxed)) {
+        }
+    }
+
+    void LatencyTuner::add_decision(double new_latency, TuneReason reason,
+        int underflow_count, double min_margin)
+    {
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - m_start_time;
+        LatencyDecision decision = {
+            elapsed.count(), m_latency, new_latency, reason,
+            underflow_count, min_margin
+        };
+        if (m_history.size() == max_history) {
+            m_history.erase(m_history.begin());
+        }
+        m_history.push_back(decision);
+        m_latency = new_latency;
+    }
+}
@@ -0,0 +1,160 @@
+#include <cmath>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/meter.h"
+#include "convert.h"
+
+namespace sio
+{
+    template<typename Reader>
+    static void accumulate(const char* ptr, int step, int frame_count,
+        float scale, float clip_level, float& peak, double& square_sum,
+        unsigned& clip_count)
+    {
+        float block_peak = peak;
+        float block_sum = 0.0f;
+        unsigned block_clips = 0;
+        for (int i = 0; i < frame_count; i++) {
+            float sample = Reader::read(ptr, scale);
+            float magnitude = std::fabs(sample);
+            block_peak = magnitude > block_peak ? magnitude : block_peak;
+            block_sum += sample * sample;
+            block_clips += magnitude >= clip_level ? 1 : 0;
+            ptr += step;
+        }
+        peak = block_peak;
+        square_sum += block_sum;
+        clip_count += block_clips;
+    }
+
+    struct AccumulateVisitor
+    {
+        const char* ptr;
+        int step;
+        int frame_count;
+        float clip_level;
+        float* peak;
+        double* square_sum;
+        unsigned* clip_count;
+
+        template<typename Reader>
+        void apply(float scale)
+        {
+            accumulate<Reader>(ptr, step, frame_count, scale, clip_level,
+                *peak, *square_sum, *clip_count);
+        }
+    };
+
+    Meter::Meter()
+    {
+        for (int ch = 0; ch < SOUNDIO_MAX_CHANNELS; ch++) {
+            m_peak[ch] = 0.0f;
+            m_square_sum[ch] = 0.0;
+            m_clip_count[ch] = 0;
+        }
+        m_frames = 0;
+        m_window_frames = 1024;
+        m_clip_level = 0.999f;
+    }
+
+    void Meter::process(FormatId format, const ChannelArea* areas,
+        int channel_count, int frame_count)
+    {
+        if (channel_count > SOUNDIO_MAX_CHANNELS) {
+            channel_count = SOUNDIO_MAX_CHANNELS;
+        }
+        int window_frames = m_window_frames.load(std::memory_order_relaxed);
+        float clip_level = m_clip_level.load(std::memory_order_relaxed);
+        if (m_frames >= window_frames) {
+            // The window shrank below what was already gathered
+            publish(channel_count);
+        }
+
+        int offset = 0;
+        while (offset < frame_count) {
+            int chunk = window_frames - m_frames;
+            if (chunk > frame_count - offset) {
+                chunk = frame_count - offset;
+            }
+
+            for (int ch = 0; ch < channel_count; ch++) {
+                AccumulateVisitor visitor = {
+                    areas[ch].ptr + offset * areas[ch].step, areas[ch].step,
+                    chunk, clip_level, &m_peak[ch], &m_square_sum[ch],
+                    &m_clip_count[ch]
+                };
+                if (!visit_reader(static_cast<SoundIoFormat>(format), visitor)) {
+                    // Foreign endian and unsigned wide formats aren't metered
+                    return;
+                }
+            }
+
+            m_frames += chunk;
+            if (m_frames >= window_frames) {
+                publish(channel_count);
+            }
+            offset += chunk;
+        }
+    }
+
+    std::vector<ChannelLevel> Meter::read() const
+    {
+        Reading reading = m_reading.load();
+        return std::vector<ChannelLevel>(
+            reading.channels, reading.channels + reading.channel_count);
+    }
+
+    int Meter::read(ChannelLevel* levels, int level_count) const
+    {
+        Reading reading = m_reading.load();
+        if (level_count > reading.channel_count) {
+            level_count = reading.channel_count;
+        }
+        for (int ch = 0; ch < level_count; ch++) {
+            levels[ch] = reading.channels[ch];
+        }
+        return level_count;
+    }
+
+    // Getters/Setters
+
+    int Meter::get_window_frames() const
+    {
+        return m_window_frames.load(std::memory_order_relaxed);
+    }
+
+    void Meter::set_window_frames(int window_frames)
+    {
+        if (window_frames < 1) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        m_window_frames.store(window_frames, std::memory_order_relaxed);
+    }
+
+    float Meter::get_clip_level() const
+    {
+        return m_clip_level.load(std::memory_order_relaxed);
+    }
+
+    void Meter::set_clip_level(float clip_level)
+    {
+        m_clip_level.store(clip_level, std::memory_order_relaxed);
+    }
+
+    void Meter::publish(int channel_count)
+    {
+        Reading reading;
+        reading.channel_count = channel_count;
+        for (int ch = 0; ch < channel_count; ch++) {
+            reading.channels[ch].peak = m_peak[ch];
+            reading.channels[ch].rms = static_cast<float>(
+                std::sqrt(m_square_sum[ch] / m_frames));
+            reading.channels[ch].clip_count = m_clip_count[ch];
+            m_peak[ch] = 0.0f;
+            m_square_sum[ch] = 0.0;
+        }
+        m_reading.store(reading);
+        m_frames = 0;
+    }
+}
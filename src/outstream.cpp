@@ -2,6 +2,13 @@
 #include <functional>
 #include "soundio/soundio.h"
 #include "soundiopp/soundiopp.h"
+#include "soundiopp/meter.h"
+#include "soundiopp/analysis.h"
+#include "soundiopp/callbacktrace.h"
+#include "soundiopp/clock.h"
+#include "soundiopp/rtcheck.h"
+#include "soundiopp/threading.h"
+#include "soundiopp/trace.h"
 
 namespace sio
 {
@@ -9,6 +16,15 @@ namespace sio
     {
         m_outstream = nullptr;
         m_device = nullptr;
+        m_driver = nullptr;
+        m_meter = nullptr;
+        m_tap = nullptr;
+        m_clock = nullptr;
+        m_tracer = nullptr;
+        m_thread_tuner = nullptr;
+        m_recorder = nullptr;
+        m_write_areas = nullptr;
+        m_write_frames = 0;
         m_userdata = nullptr;
     }
 
@@ -16,20 +32,58 @@ namespace sio
     {
         m_outstream = outstream;
         m_device = device;
+        m_driver = nullptr;
+        m_meter = nullptr;
+        m_tap = nullptr;
+        m_clock = nullptr;
+        m_tracer = nullptr;
+        m_thread_tuner = nullptr;
+        m_recorder = nullptr;
+        m_write_areas = nullptr;
+        m_write_frames = 0;
         m_userdata = m_outstream->userdata;
         m_outstream->userdata = this;
     }
 
+    OutStream::OutStream(Driver* driver)
+    {
+        // Not backed by libsoundio, the struct only holds the parameters
+        m_outstream = new SoundIoOutStream();
+        m_device = nullptr;
+        m_driver = driver;
+        m_meter = nullptr;
+        m_tap = nullptr;
+        m_clock = nullptr;
+        m_tracer = nullptr;
+        m_thread_tuner = nullptr;
+        m_recorder = nullptr;
+        m_write_areas = nullptr;
+        m_write_frames = 0;
+        m_userdata = nullptr;
+        m_outstream->userdata = this;
+    }
+
     OutStream::OutStream(OutStream&& other)
     {
         m_outstream = other.m_outstream;
         m_device = other.m_device;
+        m_driver = other.m_driver;
+        m_meter = other.m_meter;
+        m_tap = other.m_tap;
+        m_clock = other.m_clock;
+        m_tracer = other.m_tracer;
+        m_thread_tuner = other.m_thread_tuner;
+        m_recorder = other.m_recorder;
+        m_write_areas = other.m_write_areas;
+        m_write_frames = other.m_write_frames;
         m_userdata = other.m_userdata;
         m_name = other.m_name;
         m_write_callback = other.m_write_callback;
         m_underflow_callback = other.m_underflow_callback;
         m_error_callback = other.m_error_callback;
-        m_outstream->userdata = this;
+        if (m_outstream != nullptr) {
+            m_outstream->userdata = this;
+        }
         other.m_outstream = nullptr;
     }
 
@@ -38,23 +92,46 @@ namespace sio
         if (&other == this) {
             return *this;
         }
-        if (m_outstream != nullptr) {
+        if (m_driver != nullptr) {
+            if (m_outstream != nullptr) {
+                m_driver->close(this);
+            }
+            delete m_outstream;
+        } else if (m_outstream != nullptr) {
             soundio_outstream_destroy(m_outstream);
         }
         m_outstream = other.m_outstream;
         m_device = other.m_device;
+        m_driver = other.m_driver;
+        m_meter = other.m_meter;
+        m_tap = other.m_tap;
+        m_clock = other.m_clock;
+        m_tracer = other.m_tracer;
+        m_thread_tuner = other.m_thread_tuner;
+        m_recorder = other.m_recorder;
+        m_write_areas = other.m_write_areas;
+        m_write_frames = other.m_write_frames;
         m_userdata = other.m_userdata;
         m_name = other.m_name;
         m_write_callback = other.m_write_callback;
         m_underflow_callback = other.m_underflow_callback;
         m_error_callback = other.m_error_callback;
-        m_outstream->userdata = this;
+        if (m_outstream != nullptr) {
+            m_outstream->userdata = this;
+        }
         other.m_outstream = nullptr;
         return *this;
     }
 
     OutStream::~OutStream()
     {
+        if (m_driver != nullptr) {
+            if (m_outstream != nullptr) {
+                m_driver->close(this);
+            }
+            delete m_outstream;
+            return;
+        }
         soundio_outstream_destroy(m_outstream);
     }
 
@@ -70,6 +147,27 @@ namespace sio
 
     void OutStream::open()
     {
+        if (m_driver != nullptr) {
+            // Same defaults soundio_outstream_open applies
+            if (m_outstream->format == SoundIoFormatInvalid) {
+                m_outstream->format = SoundIoFormatFloat32NE;
+            }
+            if (m_outstream->sample_rate == 0) {
+                m_outstream->sample_rate = 48000;
+            }
+            if (m_outstream->layout.channel_count == 0) {
+                m_outstream->layout = ChannelLayout::get_default(2);
+            }
+            if (m_outstream->name == nullptr) {
+                m_outstream->name = "SoundIoOutStream";
+            }
+            m_outstream->bytes_per_sample =
+                soundio_get_bytes_per_sample(m_outstream->format);
+            m_outstream->bytes_per_frame = soundio_get_bytes_per_frame(
+                m_outstream->format, m_outstream->layout.channel_count);
+            m_driver->open(this);
+            return;
+        }
         WRAP_SOUNDIO_ERROR(soundio_outstream_open(m_outstream));
         if (m_outstream->layout_error) {
             throw soundio_error(m_outstream->layout_error);
@@ -78,34 +176,53 @@ namespace sio
 
     void OutStream::start()
     {
+        if (m_driver != nullptr) {
+            m_driver->start(this);
+            return;
+        }
         WRAP_SOUNDIO_ERROR(soundio_outstream_start(m_outstream));
     }
 
     int OutStream::begin_write(ChannelArea*& areas, int frame_count)
     {
-        WRAP_SOUNDIO_ERROR(soundio_outstream_begin_write(
-            m_outstream, &areas, &frame_count));
-        // frame_count gets modified by begin_write
+        ErrorId err = try_begin_write(areas, frame_count);
+        if (err != ErrorId::None) {
+            throw soundio_error(err);
+        }
         return frame_count;
     }
 
     void OutStream::end_write()
     {
-        WRAP_SOUNDIO_ERROR(soundio_outstream_end_write(m_outstream));
+        ErrorId err = try_end_write();
+        if (err != ErrorId::None) {
+            throw soundio_error(err);
+        }
     }
 
     void OutStream::clear_buffer()
     {
+        if (m_driver != nullptr) {
+            m_driver->clear_buffer(this);
+            return;
+        }
         WRAP_SOUNDIO_ERROR(soundio_outstream_clear_buffer(m_outstream));
     }
 
     void OutStream::pause(bool paused)
     {
+        if (m_driver != nullptr) {
+            m_driver->pause(this, paused);
+            return;
+        }
         WRAP_SOUNDIO_ERROR(soundio_outstream_pause(m_outstream, paused));
     }
 
     double OutStream::get_latency()
     {
+        if (m_driver != nullptr) {
+            return m_driver->get_latency(this);
+        }
         double latency;
         WRAP_SOUNDIO_ERROR(soundio_outstream_get_latency(
             m_outstream, &latency));
@@ -114,26 +231,11 @@ namespace sio
 
     // Getters/Setters
 
-    Device* OutStream::get_device()
-    {
-        return m_device;
-    }
-
-    FormatId OutStream::get_format() const
-    {
-        return static_cast<FormatId>(m_outstream->format);
-    }
-
     void OutStream::set_format(FormatId format)
     {
         m_outstream->format = static_cast<SoundIoFormat>(format);
     }
 
-    int OutStream::get_sample_rate() const
-    {
-        return m_outstream->sample_rate;
-    }
-
     void OutStream::set_sample_rate(int sample_rate)
     {
         m_outstream->sample_rate = sample_rate;
@@ -159,11 +261,6 @@ namespace sio
         m_outstream->software_latency = software_latency;
     }
 
-    void* OutStream::get_userdata()
-    {
-        return m_userdata;
-    }
-
     void OutStream::set_userdata(void* userdata)
     {
         m_userdata = userdata;
@@ -190,14 +287,64 @@ namespace sio
         m_outstream->non_terminal_hint = hint;
     }
 
-    int OutStream::get_bytes_per_frame() const
+    Meter* OutStream::get_meter()
     {
-        return m_outstream->bytes_per_frame;
+        return m_meter;
     }
 
-    int OutStream::get_bytes_per_sample() const
+    void OutStream::set_meter(Meter* meter)
     {
-        return m_outstream->bytes_per_sample;
+        m_meter = meter;
+    }
+
+    AnalysisTap* OutStream::get_tap()
+    {
+        return m_tap;
+    }
+
+    void OutStream::set_tap(AnalysisTap* tap)
+    {
+        m_tap = tap;
+    }
+
+    StreamClock* OutStream::get_clock()
+    {
+        return m_clock;
+    }
+
+    void OutStream::set_clock(StreamClock* clock)
+    {
+        m_clock = clock;
+    }
+
+    Tracer* OutStream::get_tracer()
+    {
+        return m_tracer;
+    }
+
+    void OutStream::set_tracer(Tracer* tracer)
+    {
+        m_tracer = tracer;
+    }
+
+    ThreadTuner* OutStream::get_thread_tuner()
+    {
+        return m_thread_tuner;
+    }
+
+    void OutStream::set_thread_tuner(ThreadTuner* thread_tuner)
+    {
+        m_thread_tuner = thread_tuner;
+    }
+
+    CallbackRecorder* OutStream::get_recorder()
+    {
+        return m_recorder;
+    }
+
+    void OutStream::set_recorder(CallbackRecorder* recorder)
+    {
+        m_recorder = recorder;
     }
 
     std::function<void(OutStream*, int, int)> OutStream::get_write_callback()
@@ -240,20 +387,50 @@ namespace sio
         SoundIoOutStream* stream, int frame_count_min, int frame_count_max)
     {
         OutStream* outstream = static_cast<OutStream*>(stream->userdata);
-        auto cb = outstream->get_write_callback();
-        cb(outstream, frame_count_min, frame_count_max);
+        RtScope realtime;
+        if (outstream->m_thread_tuner != nullptr) {
+            outstream->m_thread_tuner->update();
+        }
+        TraceScope trace(outstream->m_tracer, "write_callback");
+        if (outstream->m_recorder != nullptr) {
+            outstream->m_recorder->callback(
+                outstream, frame_count_min, frame_count_max);
+        }
+        if (outstream->m_clock != nullptr) {
+            // The next frame written becomes audible after the latency
+            double latency = 0.0;
+            if (outstream->m_driver != nullptr) {
+                latency = outstream->m_driver->get_latency(outstream);
+            } else {
+                soundio_outstream_get_latency(stream, &latency);
+            }
+            outstream->m_clock->update(
+                StreamClock::now() + latency, stream->sample_rate);
+        }
+        // Called directly, a copy of the std::function could allocate
+        outstream->m_write_callback(
+            outstream, frame_count_min, frame_count_max);
     }
 
     void OutStream::underflow_callback_wrapper(SoundIoOutStream* stream)
     {
         OutStream* outstream = static_cast<OutStream*>(stream->userdata);
-        auto cb = outstream->get_underflow_callback();
-        cb(outstream);
+        RtScope realtime;
+        if (outstream->m_tracer != nullptr) {
+            outstream->m_tracer->instant("underflow");
+        }
+        if (outstream->m_recorder != nullptr) {
+            outstream->m_recorder->xrun();
+        }
+        outstream->m_underflow_callback(outstream);
     }
 
     void OutStream::error_callback_wrapper(SoundIoOutStream* stream, int err)
     {
         OutStream* outstream = static_cast<OutStream*>(stream->userdata);
+        if (outstream->m_tracer != nullptr) {
+            outstream->m_tracer->instant("stream_error");
+        }
         auto cb = outstream->get_error_callback();
         cb(outstream, err);
     }
@@ -0,0 +1,210 @@
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/render.h"
+
+namespace sio
+{
+    static void put_le(std::ofstream& file, uint32_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++) {
+            file.put(static_cast<char>((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    RenderStream::RenderStream()
+    {
+        m_stream = nullptr;
+        m_callback_frames_min = 0;
+        m_callback_frames_max = 1024;
+        m_budget = 0;
+        m_write_frames = 0;
+        m_frames_rendered = 0;
+        m_render_seconds = 0.0;
+    }
+
+    OutStream RenderStream::create_outstream()
+    {
+        return OutStream(this);
+    }
+
+    int RenderStream::render(int frame_count)
+    {
+        if (m_stream == nullptr) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        m_output.reserve(
+            m_output.size() + frame_count * m_stream->bytes_per_frame);
+
+        auto start_time = std::chrono::steady_clock::now();
+        int frames_left = frame_count;
+        while (frames_left > 0) {
+            int frame_count_max = m_callback_frames_max < frames_left ?
+                m_callback_frames_max : frames_left;
+            int frame_count_min = m_callback_frames_min < frame_count_max ?
+                m_callback_frames_min : frame_count_max;
+            m_budget = frame_count_max;
+            write_callback(m_stream, frame_count_min, frame_count_max);
+
+            int written = frame_count_max - m_budget;
+            if (written == 0) {
+                // The callback declined to write anything, stop instead of
+                // spinning forever
+                break;
+            }
+            frames_left -= written;
+        }
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start_time;
+        m_render_seconds += elapsed.count();
+        m_budget = 0;
+
+        int rendered = frame_count - frames_left;
+        m_frames_rendered += rendered;
+        return rendered;
+    }
+
+    void RenderStream::clear_output()
+    {
+        m_output.clear();
+    }
+
+    void RenderStream::save_wav(const std::string& path) const
+    {
+        if (m_stream == nullptr) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        int format_tag;
+        switch (m_stream->format) {
+        case SoundIoFormatU8:
+        case SoundIoFormatS16LE:
+        case SoundIoFormatS32LE:
+            format_tag = 1;
+            break;
+        case SoundIoFormatFloat32LE:
+        case SoundIoFormatFloat64LE:
+            format_tag = 3;
+            break;
+        default:
+            // WAV has no representation for the remaining formats
+            throw soundio_error(ErrorId::IncompatibleDevice);
+        }
+
+        std::ofstream file(path.c_str(), std::ios::binary);
+        if (!file) {
+            throw soundio_error(ErrorId::OpeningDevice);
+        }
+        uint32_t data_size = static_cast<uint32_t>(m_output.size());
+        int channel_count = m_stream->layout.channel_count;
+        int bytes_per_frame = m_stream->bytes_per_frame;
+        file.write("RIFF", 4);
+        put_le(file, 36 + data_size, 4);
+        file.write("WAVEfmt ", 8);
+        put_le(file, 16, 4);
+        put_le(file, format_tag, 2);
+        put_le(file, channel_count, 2);
+        put_le(file, m_stream->sample_rate, 4);
+        put_le(file, m_stream->sample_rate * bytes_per_frame, 4);
+        put_le(file, bytes_per_frame, 2);
+        put_le(file, m_stream->bytes_per_sample * 8, 2);
+        file.write("data", 4);
+        put_le(file, data_size, 4);
+        file.write(m_output.data(), m_output.size());
+        if (!file) {
+            throw soundio_error(ErrorId::Streaming);
+        }
+    }
+
+    // Getters/Setters
+
+    const std::vector<char>& RenderStream::get_output() const
+    {
+        return m_output;
+    }
+
+    long long RenderStream::get_frames_rendered() const
+    {
+        return m_frames_rendered;
+    }
+
+    double RenderStream::get_realtime_factor() const
+    {
+        if (m_stream == nullptr || m_render_seconds == 0.0) {
+            return 0.0;
+        }
+        double audio_seconds =
+            static_cast<double>(m_frames_rendered) / m_stream->sample_rate;
+        return audio_seconds / m_render_seconds;
+    }
+
+    int RenderStream::get_callback_frames_min() const
+    {
+        return m_callback_frames_min;
+    }
+
+    int RenderStream::get_callback_frames_max() const
+    {
+        return m_callback_frames_max;
+    }
+
+    void RenderStream::set_callback_frames(
+        int frame_count_min, int frame_count_max)
+    {
+        m_callback_frames_min = frame_count_min;
+        m_callback_frames_max = frame_count_max;
+    }
+
+    // Driver
+
+    void RenderStream::open(OutStream* outstream)
+    {
+        m_stream = *outstream;
+        m_areas.resize(m_stream->layout.channel_count);
+    }
+
+    void RenderStream::close(OutStream* outstream)
+    {
+        if (m_stream == static_cast<SoundIoOutStream*>(*outstream)) {
+            m_stream = nullptr;
+        }
+    }
+
+    ErrorId RenderStream::begin_write(OutStream* outstream,
+        ChannelArea*& areas, int& frame_count) noexcept
+    {
+        (void)outstream;
+        if (m_stream == nullptr) {
+            return ErrorId::Invalid;
+        }
+        if (frame_count > m_budget) {
+            frame_count = m_budget;
+        }
+        size_t offset = m_output.size();
+        try {
+            m_output.resize(offset + frame_count * m_stream->bytes_per_frame);
+        } catch (const std::bad_alloc&) {
+            return ErrorId::NoMem;
+        }
+        for (size_t ch = 0; ch < m_areas.size(); ch++) {
+            m_areas[ch].ptr = m_output.data() + offset
+                + ch * m_stream->bytes_per_sample;
+            m_areas[ch].step = m_stream->bytes_per_frame;
+        }
+        areas = m_areas.data();
+        m_write_frames = frame_count;
+        return ErrorId::None;
+    }
+
+    ErrorId RenderStream::end_write(OutStream* outstream) noexcept
+    {
+        (void)outstream;
+        m_budget -= m_write_frames;
+        m_write_frames = 0;
+        return ErrorId::None;
+    }
+}
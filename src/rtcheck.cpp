@@ -0,0 +1,248 @@
+#include <atomic>
+#include "soundiopp/rtcheck.h"
+
+#ifdef SOUNDIOPP_RT_CHECK
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Static TLS, so reading the flags from inside malloc never allocates
+#define SOUNDIOPP_TLS __attribute__((tls_model("initial-exec")))
+#else
+#define SOUNDIOPP_TLS
+#endif
+
+namespace sio
+{
+    static thread_local bool t_realtime SOUNDIOPP_TLS = false;
+    static std::atomic<unsigned long long> violation_count(0);
+    static std::atomic<bool> abort_on_violation(false);
+
+    RtScope::RtScope()
+    {
+        m_previous = t_realtime;
+        t_realtime = true;
+    }
+
+    RtScope::~RtScope()
+    {
+        t_realtime = m_previous;
+    }
+
+    bool RtCheck::is_enabled()
+    {
+#ifdef SOUNDIOPP_RT_CHECK
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool RtCheck::is_realtime_thread()
+    {
+        return t_realtime;
+    }
+
+    unsigned long long RtCheck::get_violation_count()
+    {
+        return violation_count.load();
+    }
+
+    bool RtCheck::get_abort_on_violation()
+    {
+        return abort_on_violation.load();
+    }
+
+    void RtCheck::set_abort_on_violation(bool abort)
+    {
+        abort_on_violation.store(abort);
+    }
+
+#ifdef SOUNDIOPP_RT_CHECK
+    static thread_local bool t_reporting SOUNDIOPP_TLS = false;
+
+    static int (*real_mutex_lock)(pthread_mutex_t*);
+    static int (*real_cond_wait)(pthread_cond_t*, pthread_mutex_t*);
+    static int (*real_cond_timedwait)(
+        pthread_cond_t*, pthread_mutex_t*, const timespec*);
+    static int (*real_nanosleep)(const timespec*, timespec*);
+    static int (*real_clock_nanosleep)(
+        clockid_t, int, const timespec*, timespec*);
+    static int (*real_usleep)(useconds_t);
+
+    static void report(const char* function)
+    {
+        violation_count.fetch_add(1);
+        // Reporting itself may allocate, don't recurse into it
+        t_reporting = true;
+        char message[128];
+        int length = std::snprintf(message, sizeof(message),
+            "soundiopp: %s called on a real-time thread\n", function);
+        if (write(STDERR_FILENO, message, length) < 0) {
+            // Nothing left to report to
+        }
+        void* frames[64];
+        int frame_count = backtrace(frames, 64);
+        backtrace_symbols_fd(frames + 2, frame_count - 2, STDERR_FILENO);
+        t_reporting = false;
+        if (abort_on_violation.load()) {
+            std::abort();
+        }
+    }
+
+    static inline void check(const char* function)
+    {
+        if (t_realtime && !t_reporting) {
+            report(function);
+        }
+    }
+
+    template<typename Function>
+    static void resolve(Function& function, const char* name)
+    {
+        function = reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+    }
+
+    // Constructors of other libraries may get here before rt_check_init
+    template<typename Function>
+    static Function next(Function& function, const char* name)
+    {
+        if (function == nullptr) {
+            resolve(function, name);
+        }
+        return function;
+    }
+
+    // Resolve everything up front so the checks never load anything from
+    // an audio thread
+    __attribute__((constructor))
+    static void rt_check_init()
+    {
+        resolve(real_mutex_lock, "pthread_mutex_lock");
+        resolve(real_cond_wait, "pthread_cond_wait");
+        resolve(real_cond_timedwait, "pthread_cond_timedwait");
+        resolve(real_nanosleep, "nanosleep");
+        resolve(real_clock_nanosleep, "clock_nanosleep");
+        resolve(real_usleep, "usleep");
+        // The first backtrace loads the unwinder
+        void* frame;
+        backtrace(&frame, 1);
+        const char* abort_env = std::getenv("SOUNDIOPP_RT_ABORT");
+        if (abort_env != nullptr && std::strcmp(abort_env, "1") == 0) {
+            abort_on_violation.store(true);
+        }
+    }
+#endif
+}
+
+#ifdef SOUNDIOPP_RT_CHECK
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+    void* __libc_memalign(size_t alignment, size_t size);
+    void __libc_free(void* ptr);
+
+    void* malloc(size_t size)
+    {
+        sio::check("malloc");
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        sio::check("calloc");
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* ptr, size_t size)
+    {
+        sio::check("realloc");
+        return __libc_realloc(ptr, size);
+    }
+
+    void free(void* ptr)
+    {
+        if (ptr != nullptr) {
+            sio::check("free");
+        }
+        __libc_free(ptr);
+    }
+
+    void* memalign(size_t alignment, size_t size)
+    {
+        sio::check("memalign");
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size)
+    {
+        sio::check("aligned_alloc");
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** ptr, size_t alignment, size_t size)
+    {
+        sio::check("posix_memalign");
+        if (alignment % sizeof(void*) != 0 ||
+                (alignment & (alignment - 1)) != 0) {
+            return EINVAL;
+        }
+        void* result = __libc_memalign(alignment, size);
+        if (result == nullptr) {
+            return ENOMEM;
+        }
+        *ptr = result;
+        return 0;
+    }
+
+    int pthread_mutex_lock(pthread_mutex_t* mutex)
+    {
+        sio::check("pthread_mutex_lock");
+        return sio::next(sio::real_mutex_lock, "pthread_mutex_lock")(mutex);
+    }
+
+    int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex)
+    {
+        sio::check("pthread_cond_wait");
+        return sio::next(sio::real_cond_wait, "pthread_cond_wait")(
+            cond, mutex);
+    }
+
+    int pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex,
+        const timespec* abstime)
+    {
+        sio::check("pthread_cond_timedwait");
+        return sio::next(sio::real_cond_timedwait,
+            "pthread_cond_timedwait")(cond, mutex, abstime);
+    }
+
+    int nanosleep(const timespec* request, timespec* remaining)
+    {
+        sio::check("nanosleep");
+        return sio::next(sio::real_nanosleep, "nanosleep")(request, remaining);
+    }
+
+    int clock_nanosleep(clockid_t clock, int flags, const timespec* request,
+        timespec* remaining)
+    {
+        sio::check("clock_nanosleep");
+        return sio::next(sio::real_clock_nanosleep, "clock_nanosleep")(
+            clock, flags, request, remaining);
+    }
+
+    int usleep(useconds_t usec)
+    {
+        sio::check("usleep");
+        return sio::next(sio::real_usleep, "usleep")(usec);
+    }
+}
+#endif
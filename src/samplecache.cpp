@@ -0,0 +1,554 @@
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/samplecache.h"
+#include "soundiopp/dither.h"
+#include "soundiopp/threading.h"
+#include "convert.h"
+
+namespace sio
+{
+    enum EntryState {
+        EntryPending,
+        EntryReady,
+        EntryFailed
+    };
+
+    struct SampleHandle::Entry
+    {
+        std::string source;
+        SampleFormat format;
+        std::atomic<int> state;
+        std::atomic<int> refs;
+        std::vector<char> storage;
+        char* data;
+        int frame_count;
+        unsigned long long last_used;
+    };
+
+    static const int sample_alignment = 64;
+
+    static uint32_t get_le(const char* ptr, int bytes)
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < bytes; i++) {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(ptr[i]))
+                << (8 * i);
+        }
+        return value;
+    }
+
+    // SampleHandle
+
+    SampleHandle::SampleHandle()
+    {
+        m_entry = nullptr;
+    }
+
+    SampleHandle::SampleHandle(Entry* entry)
+    {
+        m_entry = entry;
+        if (m_entry != nullptr) {
+            m_entry->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    SampleHandle::SampleHandle(const SampleHandle& other)
+        : SampleHandle(other.m_entry)
+    {
+    }
+
+    SampleHandle::SampleHandle(SampleHandle&& other)
+    {
+        m_entry = other.m_entry;
+        other.m_entry = nullptr;
+    }
+
+    SampleHandle& SampleHandle::operator=(const SampleHandle& other)
+    {
+        if (other.m_entry != nullptr) {
+            other.m_entry->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (m_entry != nullptr) {
+            m_entry->refs.fetch_sub(1, std::memory_order_release);
+        }
+        m_entry = other.m_entry;
+        return *this;
+    }
+
+    SampleHandle& SampleHandle::operator=(SampleHandle&& other)
+    {
+        if (&other == this) {
+            return *this;
+        }
+        if (m_entry != nullptr) {
+            m_entry->refs.fetch_sub(1, std::memory_order_release);
+        }
+        m_entry = other.m_entry;
+        other.m_entry = nullptr;
+        return *this;
+    }
+
+    SampleHandle::~SampleHandle()
+    {
+        if (m_entry != nullptr) {
+            m_entry->refs.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    bool SampleHandle::is_valid() const
+    {
+        return m_entry != nullptr;
+    }
+
+    bool SampleHandle::is_ready() const
+    {
+        return m_entry != nullptr &&
+            m_entry->state.load(std::memory_order_acquire) == EntryReady;
+    }
+
+    bool SampleHandle::is_failed() const
+    {
+        return m_entry != nullptr &&
+            m_entry->state.load(std::memory_order_acquire) == EntryFailed;
+    }
+
+    const char* SampleHandle::get_data() const
+    {
+        return is_ready() ? m_entry->data : nullptr;
+    }
+
+    int SampleHandle::get_frame_count() const
+    {
+        return is_ready() ? m_entry->frame_count : 0;
+    }
+
+    SampleFormat SampleHandle::get_format() const
+    {
+        if (m_entry == nullptr) {
+            SampleFormat format = {FormatId::Invalid, 0, 0};
+            return format;
+        }
+        return m_entry->format;
+    }
+
+    VoiceSample SampleHandle::get_voice_sample() const
+    {
+        VoiceSample sample = {nullptr, 0, 0, 0};
+        if (!is_ready() ||
+                m_entry->format.format !=
+                    static_cast<FormatId>(SoundIoFormatFloat32NE) ||
+                m_entry->format.channel_count > 2) {
+            return sample;
+        }
+        sample.samples = reinterpret_cast<const float*>(m_entry->data);
+        sample.frame_count = m_entry->frame_count;
+        sample.channel_count = m_entry->format.channel_count;
+        sample.sample_rate = m_entry->format.sample_rate;
+        return sample;
+    }
+
+    // SampleCache
+
+    SampleCache::SampleCache(size_t memory_budget)
+    {
+        m_loader = load_wav;
+        m_memory_budget = memory_budget;
+        m_memory_used = 0;
+        m_tick = 0;
+        m_hits = 0;
+        m_misses = 0;
+        m_running = false;
+    }
+
+    SampleCache::~SampleCache()
+    {
+        stop();
+    }
+
+    SampleHandle SampleCache::get(const std::string& source,
+        const SampleFormat& target)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        bool created;
+        Entry* entry = lookup(source, target, created);
+        if (created) {
+            m_pending.push_back(entry);
+            m_condition.notify_all();
+        }
+        return SampleHandle(entry);
+    }
+
+    SampleHandle SampleCache::load(const std::string& source,
+        const SampleFormat& target)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        bool created;
+        Entry* entry = lookup(source, target, created);
+        SampleHandle handle(entry);
+        if (entry->state.load() != EntryPending) {
+            return handle;
+        }
+
+        bool queued = false;
+        for (auto it = m_pending.begin(); it != m_pending.end(); ++it) {
+            if (*it == entry) {
+                m_pending.erase(it);
+                queued = true;
+                break;
+            }
+        }
+        if (created || queued) {
+            lock.unlock();
+            convert(entry);
+        } else {
+            // The worker is converting it right now
+            m_condition.wait(lock, [entry]
+                {
+                    return entry->state.load() != EntryPending;
+                }
+            );
+        }
+        return handle;
+    }
+
+    void SampleCache::start()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_running) {
+            return;
+        }
+        m_running = true;
+        m_worker = std::thread(&SampleCache::run, this);
+    }
+
+    void SampleCache::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+            m_condition.notify_all();
+        }
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+    }
+
+    void SampleCache::evict()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (m_memory_used > m_memory_budget) {
+            auto victim = m_entries.end();
+            for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+                Entry* entry = it->second.get();
+                if (entry->state.load() == EntryPending ||
+                        entry->refs.load(std::memory_order_acquire) != 0) {
+                    continue;
+                }
+                if (victim == m_entries.end() ||
+                        entry->last_used < victim->second->last_used) {
+                    victim = it;
+                }
+            }
+            if (victim == m_entries.end()) {
+                // Everything left is in use
+                break;
+            }
+            m_memory_used -= victim->second->storage.size();
+            m_entries.erase(victim);
+        }
+    }
+
+    // Getters/Setters
+
+    SampleCache::Loader SampleCache::get_loader()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_loader;
+    }
+
+    void SampleCache::set_loader(Loader loader)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_loader = loader;
+    }
+
+    size_t SampleCache::get_memory_budget() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_memory_budget;
+    }
+
+    void SampleCache::set_memory_budget(size_t memory_budget)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_memory_budget = memory_budget;
+        }
+        evict();
+    }
+
+    size_t SampleCache::get_memory_used() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_memory_used;
+    }
+
+    unsigned long long SampleCache::get_hits() const
+    {
+        return m_hits.load();
+    }
+
+    unsigned long long SampleCache::get_misses() const
+    {
+        return m_misses.load();
+    }
+
+    bool SampleCache::load_wav(const std::string& path,
+        std::vector<char>& data, SampleFormat& format)
+    {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        std::vector<char> contents((std::istreambuf_iterator<char>(file)),
+            std::istreambuf_iterator<char>());
+        if (contents.size() < 12 ||
+                std::memcmp(contents.data(), "RIFF", 4) != 0 ||
+                std::memcmp(contents.data() + 8, "WAVE", 4) != 0) {
+            return false;
+        }
+
+        int format_tag = 0;
+        int bits = 0;
+        format.channel_count = 0;
+        format.sample_rate = 0;
+        const char* samples = nullptr;
+        size_t sample_bytes = 0;
+        size_t offset = 12;
+        while (offset + 8 <= contents.size()) {
+            const char* chunk = contents.data() + offset;
+            size_t size = get_le(chunk + 4, 4);
+            size_t available = contents.size() - offset - 8;
+            if (size > available) {
+                size = available;
+            }
+            if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+                format_tag = get_le(chunk + 8, 2);
+                format.channel_count = get_le(chunk + 10, 2);
+                format.sample_rate = get_le(chunk + 12, 4);
+                bits = get_le(chunk + 22, 2);
+                if (format_tag == 0xfffe && size >= 26) {
+                    // WAVE_FORMAT_EXTENSIBLE, the sub format GUID starts
+                    // with the plain format tag
+                    format_tag = get_le(chunk + 32, 2);
+                }
+            } else if (std::memcmp(chunk, "data", 4) == 0) {
+                samples = chunk + 8;
+                sample_bytes = size;
+            }
+            // Chunks are padded to an even size
+            offset += 8 + size + (size & 1);
+        }
+        if (samples == nullptr || format.channel_count <= 0 ||
+                format.sample_rate <= 0) {
+            return false;
+        }
+
+        // Samples are little endian, which libsoundio's NE formats match
+        // on the hosts this runs on
+        if (format_tag == 1 && bits == 24) {
+            // Packed 24 bit has no libsoundio format, widen to 32 bit
+            size_t sample_count = sample_bytes / 3;
+            data.resize(sample_count * 4);
+            for (size_t i = 0; i < sample_count; i++) {
+                uint32_t value = get_le(samples + i * 3, 3) << 8;
+                std::memcpy(data.data() + i * 4, &value, 4);
+            }
+            format.format = FormatId::S32LE;
+            return true;
+        }
+        if (format_tag == 1 && bits == 8) {
+            format.format = FormatId::U8;
+        } else if (format_tag == 1 && bits == 16) {
+            format.format = FormatId::S16LE;
+        } else if (format_tag == 1 && bits == 32) {
+            format.format = FormatId::S32LE;
+        } else if (format_tag == 3 && bits == 32) {
+            format.format = FormatId::Float32LE;
+        } else if (format_tag == 3 && bits == 64) {
+            format.format = FormatId::Float64LE;
+        } else {
+            return false;
+        }
+        data.assign(samples, samples + sample_bytes);
+        return true;
+    }
+
+    SampleCache::Entry* SampleCache::lookup(const std::string& source,
+        const SampleFormat& target, bool& created)
+    {
+        std::string key = source + '\n'
+            + std::to_string(static_cast<int>(target.format)) + ':'
+            + std::to_string(target.channel_count) + ':'
+            + std::to_string(target.sample_rate);
+        auto it = m_entries.find(key);
+        created = it == m_entries.end();
+        Entry* entry;
+        if (created) {
+            entry = new Entry();
+            entry->source = source;
+            entry->format = target;
+            entry->state = EntryPending;
+            entry->refs = 0;
+            entry->data = nullptr;
+            entry->frame_count = 0;
+            m_entries[key].reset(entry);
+            m_misses.fetch_add(1);
+        } else {
+            entry = it->second.get();
+            m_hits.fetch_add(1);
+        }
+        entry->last_used = ++m_tick;
+        return entry;
+    }
+
+    void SampleCache::convert(Entry* entry)
+    {
+        std::vector<char> data;
+        SampleFormat source = {FormatId::Invalid, 0, 0};
+        Loader loader = get_loader();
+        bool ok = loader && loader(entry->source, data, source);
+
+        int source_channels = source.channel_count;
+        int bytes_per_sample = ok ? get_bytes_per_sample(source.format) : -1;
+        int bytes_per_frame = bytes_per_sample * source_channels;
+        ok = ok && bytes_per_sample > 0 && source_channels > 0 &&
+            source.sample_rate > 0 && entry->format.channel_count > 0 &&
+            entry->format.sample_rate > 0;
+
+        // Decode every channel to float
+        int source_frames = ok ?
+            static_cast<int>(data.size() / bytes_per_frame) : 0;
+        std::vector<std::vector<float>> planar(ok ? source_channels : 0);
+        for (int ch = 0; ok && ch < source_channels; ch++) {
+            planar[ch].resize(source_frames);
+            ReadVisitor visitor = {
+                data.data() + ch * bytes_per_sample, bytes_per_frame,
+                source_frames, planar[ch].data()
+            };
+            ok = visit_reader(static_cast<SoundIoFormat>(source.format),
+                visitor);
+        }
+
+        // Map channels, mono is spread to all outputs and downmixing to
+        // mono averages
+        int channel_count = entry->format.channel_count;
+        std::vector<std::vector<float>> mapped(ok ? channel_count : 0);
+        for (int ch = 0; ok && ch < channel_count; ch++) {
+            if (source_channels == 1) {
+                mapped[ch] = planar[0];
+            } else if (channel_count == 1) {
+                mapped[ch].assign(source_frames, 0.0f);
+                for (int src = 0; src < source_channels; src++) {
+                    for (int i = 0; i < source_frames; i++) {
+                        mapped[ch][i] += planar[src][i] / source_channels;
+                    }
+                }
+            } else if (ch < source_channels) {
+                mapped[ch] = planar[ch];
+            } else {
+                mapped[ch].assign(source_frames, 0.0f);
+            }
+        }
+
+        // Linear interpolation is enough for effect length material
+        int frame_count = source_frames;
+        if (ok && source.sample_rate != entry->format.sample_rate &&
+                source_frames > 1) {
+            double ratio = static_cast<double>(source.sample_rate)
+                / entry->format.sample_rate;
+            frame_count = static_cast<int>((source_frames - 1) / ratio) + 1;
+            for (int ch = 0; ch < channel_count; ch++) {
+                std::vector<float> resampled(frame_count);
+                const std::vector<float>& in = mapped[ch];
+                for (int i = 0; i < frame_count; i++) {
+                    double position = i * ratio;
+                    int index = static_cast<int>(position);
+                    float fraction = static_cast<float>(position - index);
+                    float next = index + 1 < source_frames ?
+                        in[index + 1] : in[index];
+                    resampled[i] = in[index] + (next - in[index]) * fraction;
+                }
+                mapped[ch].swap(resampled);
+            }
+        }
+
+        // Store in the target format, dithered for integer formats
+        int target_bytes_per_sample = ok ?
+            get_bytes_per_sample(entry->format.format) : -1;
+        ok = ok && target_bytes_per_sample > 0;
+        if (ok) {
+            int target_bytes_per_frame = target_bytes_per_sample
+                * channel_count;
+            entry->storage.resize(static_cast<size_t>(frame_count)
+                * target_bytes_per_frame + sample_alignment);
+            uintptr_t base = reinterpret_cast<uintptr_t>(
+                entry->storage.data());
+            base = (base + sample_alignment - 1)
+                & ~static_cast<uintptr_t>(sample_alignment - 1);
+            entry->data = reinterpret_cast<char*>(base);
+            entry->frame_count = frame_count;
+
+            std::vector<const float*> channels(channel_count);
+            std::vector<ChannelArea> areas(channel_count);
+            for (int ch = 0; ch < channel_count; ch++) {
+                channels[ch] = mapped[ch].data();
+                areas[ch].ptr = entry->data + ch * target_bytes_per_sample;
+                areas[ch].step = target_bytes_per_frame;
+            }
+            Dither dither(DitherMode::Tpdf);
+            ok = dither.write(channels.data(), entry->format.format,
+                areas.data(), channel_count, frame_count);
+        }
+        if (!ok) {
+            entry->storage.clear();
+            entry->storage.shrink_to_fit();
+            entry->data = nullptr;
+            entry->frame_count = 0;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_memory_used += entry->storage.size();
+            entry->state.store(ok ? EntryReady : EntryFailed,
+                std::memory_order_release);
+            m_condition.notify_all();
+        }
+        evict();
+    }
+
+    void SampleCache::run()
+    {
+        ThreadTuner::apply_worker();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_running) {
+            if (m_pending.empty()) {
+                m_condition.wait(lock);
+                continue;
+            }
+            Entry* entry = m_pending.front();
+            m_pending.pop_front();
+            lock.unlock();
+            convert(entry);
+            lock.lock();
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/scheduler.h"
+
+namespace sio
+{
+    static bool later_event(const TimelineEvent& a, const TimelineEvent& b)
+    {
+        return a.frame > b.frame;
+    }
+
+    Scheduler::Scheduler(int capacity) : m_queue(capacity)
+    {
+        // Pending events are kept latest first so the next one is at the back
+        m_pending.reserve(capacity);
+        m_position = 0;
+        m_dropped_events = 0;
+    }
+
+    bool Scheduler::schedule(const TimelineEvent& event)
+    {
+        if (!m_queue.push(event)) {
+            m_dropped_events.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    void Scheduler::process(int frame_count)
+    {
+        drain();
+        long long position = m_position.load(std::memory_order_relaxed);
+
+        int offset = 0;
+        while (offset < frame_count) {
+            long long now = position + offset;
+            // Events in the past fire at the start of the block
+            while (!m_pending.empty() && m_pending.back().frame <= now) {
+                if (m_event_callback) {
+                    m_event_callback(m_pending.back(), offset);
+                }
+                m_pending.pop_back();
+            }
+
+            int chunk = frame_count - offset;
+            if (!m_pending.empty() && m_pending.back().frame < now + chunk) {
+                chunk = static_cast<int>(m_pending.back().frame - now);
+            }
+            if (m_render_callback) {
+                m_render_callback(offset, chunk);
+            }
+            offset += chunk;
+        }
+
+        m_position.store(position + frame_count, std::memory_order_release);
+    }
+
+    void Scheduler::locate(long long frame)
+    {
+        m_position.store(frame, std::memory_order_release);
+    }
+
+    // Getters/Setters
+
+    long long Scheduler::get_position() const
+    {
+        return m_position.load(std::memory_order_acquire);
+    }
+
+    unsigned Scheduler::get_dropped_events() const
+    {
+        return m_dropped_events.load();
+    }
+
+    std::function<void(int, int)> Scheduler::get_render_callback()
+    {
+        return m_render_callback;
+    }
+
+    void Scheduler::set_render_callback(
+        std::function<void(int, int)> render_callback)
+    {
+        m_render_callback = render_callback;
+    }
+
+    std::function<void(const TimelineEvent&, int)>
+        Scheduler::get_event_callback()
+    {
+        return m_event_callback;
+    }
+
+    void Scheduler::set_event_callback(
+        std::function<void(const TimelineEvent&, int)> event_callback)
+    {
+        m_event_callback = event_callback;
+    }
+
+    void Scheduler::drain()
+    {
+        TimelineEvent event;
+        while (m_pending.size() < m_pending.capacity() && m_queue.pop(event)) {
+            // Inserting before equal frames keeps submission order
+            auto it = std::lower_bound(m_pending.begin(), m_pending.end(),
+                event, later_event);
+            m_pending.insert(it, event);
+        }
+    }
+}
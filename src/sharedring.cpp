@@ -0,0 +1,384 @@
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+#include <new>
+#include <string>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/sharedring.h"
+
+namespace sio
+{
+    static const uint32_t shared_ring_magic = 0x52535053; // "SPSR"
+    static const uint32_t shared_ring_version = 1;
+
+    struct SharedRingHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t capacity;
+        uint32_t header_size;
+        std::atomic<uint64_t> write_offset;
+        std::atomic<uint64_t> read_offset;
+        // Bumped on every advance, futex words for the waiting side
+        std::atomic<uint32_t> write_sequence;
+        std::atomic<uint32_t> read_sequence;
+        std::atomic<uint32_t> fill_waiters;
+        std::atomic<uint32_t> free_waiters;
+        std::atomic<int32_t> reader_pid;
+        std::atomic<int32_t> writer_pid;
+    };
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+        "futex words must be plain 32 bit integers");
+
+    static int page_size()
+    {
+        return static_cast<int>(sysconf(_SC_PAGESIZE));
+    }
+
+    static void futex_wait(std::atomic<uint32_t>* word, uint32_t value,
+        const timespec* timeout)
+    {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT,
+            value, timeout, nullptr, 0);
+    }
+
+    static void futex_wake(std::atomic<uint32_t>* word)
+    {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE,
+            INT_MAX, nullptr, nullptr, 0);
+    }
+
+    static bool process_alive(int32_t pid)
+    {
+        if (pid == 0) {
+            return false;
+        }
+        return kill(pid, 0) == 0 || errno == EPERM;
+    }
+
+    SharedRingBuffer::SharedRingBuffer()
+    {
+        m_fd = -1;
+        m_capacity = 0;
+        m_header_size = 0;
+        m_mapping = nullptr;
+        m_data = nullptr;
+        m_header = nullptr;
+        m_reader = false;
+        m_writer = false;
+    }
+
+    SharedRingBuffer::SharedRingBuffer(SharedRingBuffer&& other)
+    {
+        m_fd = other.m_fd;
+        m_capacity = other.m_capacity;
+        m_header_size = other.m_header_size;
+        m_mapping = other.m_mapping;
+        m_data = other.m_data;
+        m_header = other.m_header;
+        m_reader = other.m_reader;
+        m_writer = other.m_writer;
+        other.m_fd = -1;
+        other.m_mapping = nullptr;
+        other.m_header = nullptr;
+        other.m_reader = false;
+        other.m_writer = false;
+    }
+
+    SharedRingBuffer& SharedRingBuffer::operator=(SharedRingBuffer&& other)
+    {
+        if (&other == this) {
+            return *this;
+        }
+        if (m_mapping != nullptr) {
+            release();
+            munmap(m_mapping,
+                m_header_size + 2 * static_cast<size_t>(m_capacity));
+            close(m_fd);
+        }
+        m_fd = other.m_fd;
+        m_capacity = other.m_capacity;
+        m_header_size = other.m_header_size;
+        m_mapping = other.m_mapping;
+        m_data = other.m_data;
+        m_header = other.m_header;
+        m_reader = other.m_reader;
+        m_writer = other.m_writer;
+        other.m_fd = -1;
+        other.m_mapping = nullptr;
+        other.m_header = nullptr;
+        other.m_reader = false;
+        other.m_writer = false;
+        return *this;
+    }
+
+    SharedRingBuffer::SharedRingBuffer(int fd, bool initialize, int capacity)
+    {
+        m_fd = fd;
+        m_capacity = capacity;
+        m_header_size = page_size();
+        m_reader = false;
+        m_writer = false;
+
+        // Reserve the whole range first, then map the data pages twice
+        // right after each other over it
+        size_t total = m_header_size + 2 * static_cast<size_t>(capacity);
+        void* base = mmap(nullptr, total, PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            close(fd);
+            throw soundio_error(ErrorId::NoMem);
+        }
+        m_mapping = static_cast<char*>(base);
+        m_data = m_mapping + m_header_size;
+        if (mmap(m_mapping, m_header_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+            mmap(m_data, capacity, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_FIXED, fd, m_header_size) == MAP_FAILED ||
+            mmap(m_data + capacity, capacity, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_FIXED, fd, m_header_size) == MAP_FAILED) {
+            munmap(m_mapping, total);
+            close(fd);
+            throw soundio_error(ErrorId::NoMem);
+        }
+
+        m_header = reinterpret_cast<SharedRingHeader*>(m_mapping);
+        if (initialize) {
+            new (m_header) SharedRingHeader();
+            m_header->capacity = capacity;
+            m_header->header_size = m_header_size;
+            m_header->version = shared_ring_version;
+            m_header->write_offset = 0;
+            m_header->read_offset = 0;
+            m_header->write_sequence = 0;
+            m_header->read_sequence = 0;
+            m_header->fill_waiters = 0;
+            m_header->free_waiters = 0;
+            m_header->reader_pid = 0;
+            m_header->writer_pid = 0;
+            // Written last so attach never sees a half initialized header
+            std::atomic_thread_fence(std::memory_order_release);
+            m_header->magic = shared_ring_magic;
+        }
+    }
+
+    SharedRingBuffer::~SharedRingBuffer()
+    {
+        if (m_mapping == nullptr) {
+            return;
+        }
+        release();
+        munmap(m_mapping, m_header_size + 2 * static_cast<size_t>(m_capacity));
+        close(m_fd);
+        m_mapping = nullptr;
+    }
+
+    SharedRingBuffer SharedRingBuffer::create(int requested_capacity,
+        const std::string& name)
+    {
+        int page = page_size();
+        int capacity = (requested_capacity + page - 1) / page * page;
+        if (capacity <= 0) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        int fd = static_cast<int>(syscall(SYS_memfd_create, name.c_str(), 0));
+        if (fd < 0) {
+            throw soundio_error(ErrorId::SystemResources);
+        }
+        if (ftruncate(fd, page + static_cast<off_t>(capacity)) != 0) {
+            close(fd);
+            throw soundio_error(ErrorId::NoMem);
+        }
+        return SharedRingBuffer(fd, true, capacity);
+    }
+
+    SharedRingBuffer SharedRingBuffer::attach(int fd)
+    {
+        int own_fd = dup(fd);
+        if (own_fd < 0) {
+            throw soundio_error(ErrorId::SystemResources);
+        }
+        uint32_t fields[4];
+        struct stat info;
+        if (pread(own_fd, fields, sizeof(fields), 0) != sizeof(fields) ||
+                fstat(own_fd, &info) != 0 ||
+                fields[0] != shared_ring_magic ||
+                fields[1] != shared_ring_version ||
+                fields[3] != static_cast<uint32_t>(page_size()) ||
+                info.st_size != static_cast<off_t>(fields[2]) + fields[3]) {
+            close(own_fd);
+            throw soundio_error(ErrorId::Invalid);
+        }
+        return SharedRingBuffer(own_fd, false, static_cast<int>(fields[2]));
+    }
+
+    int SharedRingBuffer::capacity()
+    {
+        return m_capacity;
+    }
+
+    char* SharedRingBuffer::write_ptr()
+    {
+        uint64_t offset = m_header->write_offset.load(std::memory_order_relaxed);
+        return m_data + offset % m_capacity;
+    }
+
+    void SharedRingBuffer::advance_write_ptr(int count)
+    {
+        m_header->write_offset.fetch_add(count);
+        m_header->write_sequence.fetch_add(1);
+        if (m_header->fill_waiters.load() > 0) {
+            futex_wake(&m_header->write_sequence);
+        }
+    }
+
+    char* SharedRingBuffer::read_ptr()
+    {
+        uint64_t offset = m_header->read_offset.load(std::memory_order_relaxed);
+        return m_data + offset % m_capacity;
+    }
+
+    void SharedRingBuffer::advance_read_ptr(int count)
+    {
+        m_header->read_offset.fetch_add(count);
+        m_header->read_sequence.fetch_add(1);
+        if (m_header->free_waiters.load() > 0) {
+            futex_wake(&m_header->read_sequence);
+        }
+    }
+
+    int SharedRingBuffer::fill_count()
+    {
+        uint64_t write_offset = m_header->write_offset.load();
+        uint64_t read_offset = m_header->read_offset.load();
+        return static_cast<int>(write_offset - read_offset);
+    }
+
+    int SharedRingBuffer::free_count()
+    {
+        return m_capacity - fill_count();
+    }
+
+    void SharedRingBuffer::clear()
+    {
+        m_header->write_offset.store(m_header->read_offset.load());
+        m_header->read_sequence.fetch_add(1);
+        if (m_header->free_waiters.load() > 0) {
+            futex_wake(&m_header->read_sequence);
+        }
+    }
+
+    bool SharedRingBuffer::wait_fill(int count, int timeout_ms)
+    {
+        return wait(true, count, timeout_ms);
+    }
+
+    bool SharedRingBuffer::wait_free(int count, int timeout_ms)
+    {
+        return wait(false, count, timeout_ms);
+    }
+
+    void SharedRingBuffer::claim_reader()
+    {
+        claim(true);
+    }
+
+    void SharedRingBuffer::claim_writer()
+    {
+        claim(false);
+    }
+
+    void SharedRingBuffer::release()
+    {
+        int32_t pid = getpid();
+        if (m_reader) {
+            m_header->reader_pid.compare_exchange_strong(pid, 0);
+            m_reader = false;
+        }
+        pid = getpid();
+        if (m_writer) {
+            m_header->writer_pid.compare_exchange_strong(pid, 0);
+            m_writer = false;
+        }
+    }
+
+    // Getters/Setters
+
+    int SharedRingBuffer::get_fd() const
+    {
+        return m_fd;
+    }
+
+    bool SharedRingBuffer::wait(bool fill, int count, int timeout_ms)
+    {
+        std::atomic<uint32_t>* sequence = fill ?
+            &m_header->write_sequence : &m_header->read_sequence;
+        std::atomic<uint32_t>* waiters = fill ?
+            &m_header->fill_waiters : &m_header->free_waiters;
+        auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(timeout_ms);
+
+        while (true) {
+            uint32_t current = sequence->load();
+            int available = fill ? fill_count() : free_count();
+            if (available >= count) {
+                return true;
+            }
+
+            timespec timeout;
+            timespec* timeout_ptr = nullptr;
+            if (timeout_ms >= 0) {
+                auto remaining = deadline - std::chrono::steady_clock::now();
+                if (remaining <= std::chrono::steady_clock::duration::zero()) {
+                    return false;
+                }
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    remaining).count();
+                timeout.tv_sec = static_cast<time_t>(ns / 1000000000);
+                timeout.tv_nsec = static_cast<long>(ns % 1000000000);
+                timeout_ptr = &timeout;
+            }
+
+            // Announce the waiter before sleeping, the other side only
+            // issues a wake syscall when someone is registered
+            waiters->fetch_add(1);
+            available = fill ? fill_count() : free_count();
+            if (available < count) {
+                futex_wait(sequence, current, timeout_ptr);
+            }
+            waiters->fetch_sub(1);
+        }
+    }
+
+    void SharedRingBuffer::claim(bool reader)
+    {
+        std::atomic<int32_t>* owner = reader ?
+            &m_header->reader_pid : &m_header->writer_pid;
+        int32_t self = getpid();
+        int32_t previous = owner->load();
+        while (previous != self) {
+            if (process_alive(previous)) {
+                throw soundio_error(ErrorId::OpeningDevice);
+            }
+            if (owner->compare_exchange_weak(previous, self)) {
+                break;
+            }
+        }
+        if (reader) {
+            m_reader = true;
+        } else {
+            m_writer = true;
+        }
+    }
+}
@@ -0,0 +1,311 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#ifdef __linux__
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/threading.h"
+
+namespace sio
+{
+    static const size_t page_size = 4096;
+
+    static SeqLock<ThreadConfig> worker_config;
+    static std::atomic<bool> worker_config_set(false);
+    static SeqLock<ThreadReport> worker_report;
+
+#ifdef __linux__
+    static pid_t current_tid()
+    {
+        return static_cast<pid_t>(syscall(SYS_gettid));
+    }
+
+    static void read_faults(long& minor, long& major)
+    {
+        rusage usage;
+        if (getrusage(RUSAGE_THREAD, &usage) != 0) {
+            minor = 0;
+            major = 0;
+            return;
+        }
+        minor = usage.ru_minflt;
+        major = usage.ru_majflt;
+    }
+
+    static int set_realtime(const ThreadConfig& config, ThreadReport& report)
+    {
+        int policy = config.policy == SchedPolicy::Fifo ?
+            SCHED_FIFO : SCHED_RR;
+        sched_param param;
+        param.sched_priority = config.priority;
+        int err = pthread_setschedparam(pthread_self(), policy, &param);
+        if (err != EPERM || !config.allow_fallback) {
+            return err;
+        }
+
+        // Unprivileged users get whatever the hard limits allow
+        rlimit limit;
+        if (getrlimit(RLIMIT_RTPRIO, &limit) == 0 && limit.rlim_max > 0) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_RTPRIO, &limit);
+            if (limit.rlim_max < static_cast<rlim_t>(param.sched_priority)) {
+                param.sched_priority = static_cast<int>(limit.rlim_max);
+            }
+            if (pthread_setschedparam(pthread_self(), policy, &param) == 0) {
+                report.fallback = true;
+                return 0;
+            }
+        }
+
+        // RLIMIT_NICE allows nice values down to 20 - limit
+        int nice = config.fallback_nice;
+        if (getrlimit(RLIMIT_NICE, &limit) == 0) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NICE, &limit);
+            int lowest = limit.rlim_max >= 40 ?
+                -20 : 20 - static_cast<int>(limit.rlim_max);
+            if (nice < lowest) {
+                nice = lowest;
+            }
+        }
+        if (nice < 0 && setpriority(PRIO_PROCESS, current_tid(), nice) == 0) {
+            report.fallback = true;
+        }
+        return err;
+    }
+
+    // Not inlined so the alloca frame is released on return
+    __attribute__((noinline)) static void touch_stack(size_t size)
+    {
+        volatile char* stack = static_cast<volatile char*>(alloca(size));
+        for (size_t i = 0; i < size; i += page_size) {
+            stack[i] = 0;
+        }
+    }
+#endif
+
+    ThreadConfig::ThreadConfig()
+    {
+        policy = SchedPolicy::Fifo;
+        priority = 50;
+        allow_fallback = true;
+        fallback_nice = -11;
+        cpu_mask = 0;
+        stack_prefault = 128 * 1024;
+    }
+
+    ThreadTuner::ThreadTuner(const ThreadConfig& config)
+    {
+        m_config.store(config);
+        m_config_version = 1;
+        m_applied_version = 0;
+        m_current = ThreadReport();
+        m_current.cpu = -1;
+        m_report.store(m_current);
+        m_minor_base = 0;
+        m_major_base = 0;
+        m_fault_interval = 0.1;
+    }
+
+    void ThreadTuner::update()
+    {
+        unsigned version = m_config_version.load(std::memory_order_acquire);
+        if (version != m_applied_version) {
+            m_applied_version = version;
+            m_current = apply(m_config.load());
+#ifdef __linux__
+            read_faults(m_minor_base, m_major_base);
+            schedule_faults(std::chrono::steady_clock::now());
+#endif
+            publish();
+            return;
+        }
+
+#ifdef __linux__
+        bool changed = false;
+        int cpu = sched_getcpu();
+        if (cpu != m_current.cpu) {
+            m_current.cpu = cpu;
+            m_current.migrations++;
+            changed = true;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now >= m_next_faults) {
+            schedule_faults(now);
+            long minor;
+            long major;
+            read_faults(minor, major);
+            if (minor - m_minor_base != m_current.minor_faults ||
+                    major - m_major_base != m_current.major_faults) {
+                m_current.minor_faults = minor - m_minor_base;
+                m_current.major_faults = major - m_major_base;
+                changed = true;
+            }
+        }
+        if (changed) {
+            publish();
+        }
+#endif
+    }
+
+    ThreadReport ThreadTuner::get_report() const
+    {
+        return m_report.load();
+    }
+
+    // Getters/Setters
+
+    ThreadConfig ThreadTuner::get_config() const
+    {
+        return m_config.load();
+    }
+
+    void ThreadTuner::set_config(const ThreadConfig& config)
+    {
+        m_config.store(config);
+        m_config_version.fetch_add(1, std::memory_order_release);
+    }
+
+    double ThreadTuner::get_fault_interval() const
+    {
+        return m_fault_interval.load(std::memory_order_relaxed);
+    }
+
+    void ThreadTuner::set_fault_interval(double fault_interval)
+    {
+        if (!(fault_interval >= 0.0)) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        m_fault_interval.store(fault_interval, std::memory_order_relaxed);
+    }
+
+    ThreadReport ThreadTuner::apply(const ThreadConfig& config)
+    {
+        ThreadReport report = ThreadReport();
+        report.applied = true;
+#ifdef __linux__
+        if (config.cpu_mask != 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int cpu = 0; cpu < 64; cpu++) {
+                if ((config.cpu_mask >> cpu) & 1) {
+                    CPU_SET(cpu, &set);
+                }
+            }
+            report.affinity_error = pthread_setaffinity_np(pthread_self(),
+                sizeof(set), &set);
+        }
+        if (config.policy != SchedPolicy::Other) {
+            report.priority_error = set_realtime(config, report);
+        }
+        if (config.stack_prefault > 0) {
+            prefault_stack(config.stack_prefault);
+        }
+
+        int policy;
+        sched_param param;
+        if (pthread_getschedparam(pthread_self(), &policy, &param) == 0) {
+            report.policy = policy == SCHED_FIFO ? SchedPolicy::Fifo :
+                policy == SCHED_RR ? SchedPolicy::RoundRobin :
+                SchedPolicy::Other;
+            report.priority = param.sched_priority;
+        }
+        report.nice = getpriority(PRIO_PROCESS, current_tid());
+        report.cpu = sched_getcpu();
+#else
+        report.affinity_error = config.cpu_mask != 0 ? ENOSYS : 0;
+        report.priority_error =
+            config.policy != SchedPolicy::Other ? ENOSYS : 0;
+        report.cpu = -1;
+#endif
+        return report;
+    }
+
+    int ThreadTuner::lock_memory()
+    {
+#ifdef __linux__
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            return errno;
+        }
+        return 0;
+#else
+        return ENOSYS;
+#endif
+    }
+
+    int ThreadTuner::prefault(void* data, size_t size)
+    {
+        int err = ENOSYS;
+#ifdef __linux__
+        if (mlock(data, size) == 0) {
+            return 0;
+        }
+        err = errno;
+#endif
+        // Could not lock, at least get the pages mapped now
+        volatile char* bytes = static_cast<volatile char*>(data);
+        for (size_t i = 0; i < size; i += page_size) {
+            bytes[i] = bytes[i];
+        }
+        return err;
+    }
+
+    void ThreadTuner::prefault_stack(size_t size)
+    {
+#ifdef __linux__
+        touch_stack(size);
+#else
+        (void)size;
+#endif
+    }
+
+    ThreadConfig ThreadTuner::get_worker_config()
+    {
+        return worker_config.load();
+    }
+
+    void ThreadTuner::set_worker_config(const ThreadConfig& config)
+    {
+        worker_config.store(config);
+        worker_config_set.store(true, std::memory_order_release);
+    }
+
+    ThreadReport ThreadTuner::get_worker_report()
+    {
+        return worker_report.load();
+    }
+
+    void ThreadTuner::apply_worker()
+    {
+        if (!worker_config_set.load(std::memory_order_acquire)) {
+            return;
+        }
+        worker_report.store(apply(worker_config.load()));
+    }
+
+    void ThreadTuner::publish()
+    {
+        m_report.store(m_current);
+    }
+
+    void ThreadTuner::schedule_faults(
+        std::chrono::steady_clock::time_point now)
+    {
+        // Capped, huge intervals would overflow the clock's duration
+        double seconds = m_fault_interval.load(std::memory_order_relaxed);
+        std::chrono::duration<double> interval(
+            seconds < 3600.0 ? seconds : 3600.0);
+        m_next_faults = now +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                interval);
+    }
+}
@@ -0,0 +1,258 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/trace.h"
+
+namespace sio
+{
+    static std::atomic<uint64_t> next_thread_number(1);
+    static std::atomic<unsigned> next_tracer_id(1);
+
+    struct TraceCache
+    {
+        unsigned tracer_id;
+        void* ring;
+    };
+
+    static thread_local uint64_t t_thread_number = 0;
+    static thread_local TraceCache t_cache = {0, nullptr};
+
+    static uint64_t trace_time()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static void write_string(std::ostream& out, const char* text)
+    {
+        out << '"';
+        for (const char* c = text; *c != '\0'; c++) {
+            if (*c == '"' || *c == '\\') {
+                out << '\\';
+            }
+            if (static_cast<unsigned char>(*c) >= 0x20) {
+                out << *c;
+            }
+        }
+        out << '"';
+    }
+
+    Tracer::Tracer(int events_per_thread, int max_threads)
+    {
+        m_events_per_thread = events_per_thread;
+        m_max_threads = max_threads;
+        m_rings.reset(new ThreadRing[max_threads]);
+        for (int i = 0; i < max_threads; i++) {
+            m_rings[i].owner = 0;
+            m_rings[i].thread_name = nullptr;
+            m_rings[i].write_count = 0;
+            m_rings[i].events.reset(new TraceEvent[events_per_thread]);
+        }
+        m_start_time = trace_time();
+        m_id = next_tracer_id.fetch_add(1);
+        m_enabled = true;
+        m_dropped_events = 0;
+    }
+
+    Tracer::~Tracer()
+    {
+        if (t_cache.tracer_id == m_id) {
+            t_cache.tracer_id = 0;
+        }
+    }
+
+    void Tracer::begin(const char* name)
+    {
+        record(name, 'B', 0);
+    }
+
+    void Tracer::end(const char* name)
+    {
+        record(name, 'E', 0);
+    }
+
+    void Tracer::instant(const char* name)
+    {
+        record(name, 'i', 0);
+    }
+
+    void Tracer::counter(const char* name, long long value)
+    {
+        record(name, 'C', value);
+    }
+
+    void Tracer::set_thread_name(const char* name)
+    {
+        ThreadRing* thread_ring = ring();
+        if (thread_ring != nullptr) {
+            thread_ring->thread_name.store(name);
+        }
+    }
+
+    void Tracer::write_json(std::ostream& out) const
+    {
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        std::vector<TraceEvent> events;
+        for (int i = 0; i < m_max_threads; i++) {
+            const ThreadRing& thread_ring = m_rings[i];
+            if (thread_ring.owner.load() == 0) {
+                continue;
+            }
+            int tid = i + 1;
+            const char* thread_name = thread_ring.thread_name.load();
+            if (thread_name != nullptr) {
+                out << (first ? "" : ",")
+                    << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                    << "\"tid\":" << tid << ",\"args\":{\"name\":";
+                write_string(out, thread_name);
+                out << "}}";
+                first = false;
+            }
+
+            // Copy first, then drop whatever the owner overwrote meanwhile
+            uint64_t end = thread_ring.write_count.load(
+                std::memory_order_acquire);
+            uint64_t start = end > static_cast<uint64_t>(m_events_per_thread)
+                ? end - m_events_per_thread : 0;
+            events.clear();
+            for (uint64_t n = start; n < end; n++) {
+                events.push_back(thread_ring.events[n % m_events_per_thread]);
+            }
+            uint64_t written = thread_ring.write_count.load(
+                std::memory_order_acquire);
+            uint64_t valid = written > static_cast<uint64_t>(
+                m_events_per_thread) ? written - m_events_per_thread : 0;
+            size_t skip = valid > start ? static_cast<size_t>(valid - start) : 0;
+
+            for (size_t n = skip; n < events.size(); n++) {
+                const TraceEvent& event = events[n];
+                uint64_t time = event.time > m_start_time ?
+                    event.time - m_start_time : 0;
+                out << (first ? "" : ",") << "\n{\"name\":";
+                write_string(out, event.name);
+                out << ",\"ph\":\"" << event.phase << "\",\"ts\":"
+                    << time / 1000 << '.' << std::setw(3) << std::setfill('0')
+                    << time % 1000 << ",\"pid\":1,\"tid\":" << tid;
+                if (event.phase == 'i') {
+                    out << ",\"s\":\"t\"";
+                } else if (event.phase == 'C') {
+                    out << ",\"args\":{\"value\":" << event.value << "}";
+                }
+                out << "}";
+                first = false;
+            }
+        }
+        out << "\n]}\n";
+    }
+
+    void Tracer::save_json(const std::string& path) const
+    {
+        std::ofstream file(path.c_str());
+        if (!file) {
+            throw soundio_error(ErrorId::OpeningDevice);
+        }
+        write_json(file);
+        if (!file) {
+            throw soundio_error(ErrorId::Streaming);
+        }
+    }
+
+    void Tracer::clear()
+    {
+        for (int i = 0; i < m_max_threads; i++) {
+            m_rings[i].write_count.store(0);
+        }
+        m_dropped_events = 0;
+        m_start_time = trace_time();
+    }
+
+    // Getters/Setters
+
+    bool Tracer::get_enabled() const
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    void Tracer::set_enabled(bool enabled)
+    {
+        m_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    unsigned long long Tracer::get_dropped_events() const
+    {
+        return m_dropped_events.load();
+    }
+
+    Tracer::ThreadRing* Tracer::ring()
+    {
+        if (t_cache.tracer_id == m_id) {
+            return static_cast<ThreadRing*>(t_cache.ring);
+        }
+        if (t_thread_number == 0) {
+            t_thread_number = next_thread_number.fetch_add(1);
+        }
+
+        ThreadRing* found = nullptr;
+        for (int i = 0; i < m_max_threads && found == nullptr; i++) {
+            if (m_rings[i].owner.load() == t_thread_number) {
+                found = &m_rings[i];
+            }
+        }
+        for (int i = 0; i < m_max_threads && found == nullptr; i++) {
+            uint64_t expected = 0;
+            if (m_rings[i].owner.compare_exchange_strong(
+                    expected, t_thread_number)) {
+                found = &m_rings[i];
+            }
+        }
+        if (found != nullptr) {
+            t_cache.tracer_id = m_id;
+            t_cache.ring = found;
+        }
+        return found;
+    }
+
+    void Tracer::record(const char* name, char phase, long long value)
+    {
+        if (!m_enabled.load(std::memory_order_relaxed)) {
+            return;
+        }
+        ThreadRing* thread_ring = ring();
+        if (thread_ring == nullptr) {
+            m_dropped_events.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        uint64_t count = thread_ring->write_count.load(
+            std::memory_order_relaxed);
+        TraceEvent& event = thread_ring->events[count % m_events_per_thread];
+        event.time = trace_time();
+        event.name = name;
+        event.phase = phase;
+        event.value = value;
+        thread_ring->write_count.store(count + 1, std::memory_order_release);
+    }
+
+    TraceScope::TraceScope(Tracer* tracer, const char* name)
+    {
+        m_tracer = tracer;
+        m_name = name;
+        if (m_tracer != nullptr) {
+            m_tracer->begin(m_name);
+        }
+    }
+
+    TraceScope::~TraceScope()
+    {
+        if (m_tracer != nullptr) {
+            m_tracer->end(m_name);
+        }
+    }
+}
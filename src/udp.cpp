@@ -0,0 +1,658 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/udp.h"
+#include "soundiopp/threading.h"
+#include "convert.h"
+
+namespace sio
+{
+    static const uint32_t packet_magic = 0x50495353; // "SSIP"
+
+    struct UdpPacketHeader
+    {
+        uint32_t magic;
+        uint32_t sequence;
+        uint64_t frame;
+        uint64_t send_time;
+        uint16_t channel_count;
+        uint16_t frame_count;
+        uint32_t reserved;
+    };
+
+    static uint64_t monotonic_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static int sequence_diff(uint32_t a, uint32_t b)
+    {
+        return static_cast<int32_t>(a - b);
+    }
+
+    UdpSender::UdpSender(const std::string& host, int port, int channel_count,
+        int packet_frames)
+        : m_queue(packet_frames * channel_count * 64), m_gaps(64)
+    {
+        addrinfo hints = addrinfo();
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* result;
+        std::string service = std::to_string(port);
+        if (getaddrinfo(host.c_str(), service.c_str(), &hints, &result) != 0) {
+            throw soundio_error(ErrorId::NoSuchDevice);
+        }
+        m_socket = socket(result->ai_family, SOCK_DGRAM, 0);
+        const char* address = reinterpret_cast<const char*>(result->ai_addr);
+        m_address.assign(address, address + result->ai_addrlen);
+        freeaddrinfo(result);
+        if (m_socket < 0) {
+            throw soundio_error(ErrorId::SystemResources);
+        }
+
+        m_channel_count = channel_count;
+        m_packet_frames = packet_frames;
+        m_convert.resize(packet_frames);
+        m_interleaved.resize(packet_frames * channel_count);
+        m_queued_frames = 0;
+        m_gap_frames = 0;
+        m_sequence = 0;
+        m_frame = 0;
+        m_sent_frames = 0;
+        m_next_gap = Gap();
+        m_have_gap = false;
+        m_packets_sent = 0;
+        m_dropped_frames = 0;
+        m_running = false;
+    }
+
+    UdpSender::~UdpSender()
+    {
+        stop();
+        close(m_socket);
+    }
+
+    void UdpSender::attach(InStream* instream)
+    {
+        // get_layout() allocates, so it stays off the audio thread
+        int channel_count = instream->get_layout().get_channel_count();
+        instream->set_read_callback(
+            [this, channel_count](InStream* stream, int frame_count_min,
+                int frame_count_max)
+            {
+                (void)frame_count_min;
+                int frames_left = frame_count_max;
+                while (frames_left > 0) {
+                    ChannelArea* areas;
+                    int frame_count = stream->begin_read(areas, frames_left);
+                    if (frame_count == 0) {
+                        break;
+                    }
+                    if (areas != nullptr) {
+                        process(stream->get_format(), areas, channel_count,
+                            frame_count);
+                    } else {
+                        skip(frame_count);
+                    }
+                    stream->end_read();
+                    frames_left -= frame_count;
+                }
+            }
+        );
+    }
+
+    void UdpSender::process(FormatId format, const ChannelArea* areas,
+        int channel_count, int frame_count)
+    {
+        if (channel_count > m_channel_count) {
+            channel_count = m_channel_count;
+        }
+
+        for (int offset = 0; offset < frame_count; offset += m_packet_frames) {
+            int chunk = frame_count - offset;
+            if (chunk > m_packet_frames) {
+                chunk = m_packet_frames;
+            }
+            for (int ch = 0; ch < m_channel_count; ch++) {
+                if (ch >= channel_count) {
+                    for (int i = 0; i < chunk; i++) {
+                        m_interleaved[i * m_channel_count + ch] = 0.0f;
+                    }
+                    continue;
+                }
+                ReadVisitor visitor = {
+                    areas[ch].ptr + offset * areas[ch].step, areas[ch].step,
+                    chunk, m_convert.data()
+                };
+                if (!visit_reader(static_cast<SoundIoFormat>(format), visitor)) {
+                    return;
+                }
+                for (int i = 0; i < chunk; i++) {
+                    m_interleaved[i * m_channel_count + ch] = m_convert[i];
+                }
+            }
+
+            int samples = chunk * m_channel_count;
+            if (m_queue.write_available() < samples) {
+                m_dropped_frames.fetch_add(chunk, std::memory_order_relaxed);
+                skip(chunk);
+                continue;
+            }
+            if (m_gap_frames > 0) {
+                Gap gap = {m_queued_frames, m_gap_frames};
+                if (m_gaps.write(&gap, 1) == 1) {
+                    m_gap_frames = 0;
+                }
+            }
+            m_queue.write(m_interleaved.data(), samples);
+            m_queued_frames += chunk;
+        }
+    }
+
+    void UdpSender::start()
+    {
+        if (m_running) {
+            return;
+        }
+        m_running = true;
+        m_worker = std::thread(&UdpSender::run, this);
+    }
+
+    void UdpSender::stop()
+    {
+        m_running = false;
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+    }
+
+    // Getters/Setters
+
+    unsigned long long UdpSender::get_packets_sent() const
+    {
+        return m_packets_sent.load();
+    }
+
+    unsigned UdpSender::get_dropped_frames() const
+    {
+        return m_dropped_frames.load();
+    }
+
+    void UdpSender::skip(int frame_count)
+    {
+        // Queued as a gap with the next frames, so the timestamps of later
+        // packets still count the skipped frames
+        m_gap_frames += frame_count;
+    }
+
+    void UdpSender::run()
+    {
+        ThreadTuner::apply_worker();
+        int samples_per_packet = m_packet_frames * m_channel_count;
+        size_t packet_size =
+            sizeof(UdpPacketHeader) + samples_per_packet * sizeof(float);
+        std::vector<char> packets(packet_size * batch_size);
+        mmsghdr messages[batch_size];
+        iovec vectors[batch_size];
+
+        while (m_running) {
+            int count = 0;
+            while (count < batch_size &&
+                    m_queue.read_available() >= samples_per_packet) {
+                while (true) {
+                    if (!m_have_gap) {
+                        if (m_gaps.read(&m_next_gap, 1) == 0) {
+                            break;
+                        }
+                        m_have_gap = true;
+                    }
+                    if (m_next_gap.position > m_sent_frames) {
+                        break;
+                    }
+                    m_frame += m_next_gap.frames;
+                    m_have_gap = false;
+                }
+
+                char* packet = packets.data() + count * packet_size;
+                UdpPacketHeader header = UdpPacketHeader();
+                header.magic = packet_magic;
+                header.sequence = m_sequence++;
+                header.frame = m_frame;
+                header.send_time = monotonic_ns();
+                header.channel_count = static_cast<uint16_t>(m_channel_count);
+                header.frame_count = static_cast<uint16_t>(m_packet_frames);
+                std::memcpy(packet, &header, sizeof(header));
+                m_queue.read(reinterpret_cast<float*>(
+                    packet + sizeof(header)), samples_per_packet);
+                m_frame += m_packet_frames;
+                m_sent_frames += m_packet_frames;
+
+                vectors[count].iov_base = packet;
+                vectors[count].iov_len = packet_size;
+                messages[count] = mmsghdr();
+                messages[count].msg_hdr.msg_name = m_address.data();
+                messages[count].msg_hdr.msg_namelen =
+                    static_cast<socklen_t>(m_address.size());
+                messages[count].msg_hdr.msg_iov = &vectors[count];
+                messages[count].msg_hdr.msg_iovlen = 1;
+                count++;
+            }
+            if (count == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            // sendmmsg stops at the first failing message. Full buffers
+            // drain quickly so those are retried a few times, whatever is
+            // still unsent after that counts as dropped.
+            int offset = 0;
+            int retries = 0;
+            while (offset < count) {
+                int sent = sendmmsg(m_socket, messages + offset,
+                    count - offset, 0);
+                if (sent > 0) {
+                    m_packets_sent.fetch_add(sent, std::memory_order_relaxed);
+                    offset += sent;
+                    retries = 0;
+                    continue;
+                }
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (retries == send_retries || !m_running || (sent < 0 &&
+                        errno != EAGAIN && errno != EWOULDBLOCK &&
+                        errno != ENOBUFS)) {
+                    break;
+                }
+                retries++;
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            if (offset < count) {
+                m_dropped_frames.fetch_add(
+                    static_cast<unsigned>((count - offset) * m_packet_frames),
+                    std::memory_order_relaxed);
+            }
+        }
+    }
+
+    UdpReceiver::UdpReceiver(int port, int channel_count, int sample_rate,
+        int packet_frames, int slot_count)
+    {
+        m_socket = socket(AF_INET6, SOCK_DGRAM, 0);
+        if (m_socket < 0) {
+            throw soundio_error(ErrorId::SystemResources);
+        }
+        // Accept IPv4 senders on the same socket
+        int v6only = 0;
+        setsockopt(m_socket, IPPROTO_IPV6, IPV6_V6ONLY,
+            &v6only, sizeof(v6only));
+        // Wake up regularly so stop() doesn't hang on an idle socket
+        timeval timeout = {0, 20000};
+        setsockopt(m_socket, SOL_SOCKET, SO_RCVTIMEO,
+            &timeout, sizeof(timeout));
+
+        sockaddr_in6 address = sockaddr_in6();
+        address.sin6_family = AF_INET6;
+        address.sin6_addr = in6addr_any;
+        address.sin6_port = htons(static_cast<uint16_t>(port));
+        if (bind(m_socket, reinterpret_cast<sockaddr*>(&address),
+                sizeof(address)) != 0) {
+            close(m_socket);
+            throw soundio_error(ErrorId::OpeningDevice);
+        }
+        socklen_t address_size = sizeof(address);
+        getsockname(m_socket, reinterpret_cast<sockaddr*>(&address),
+            &address_size);
+        m_port = ntohs(address.sin6_port);
+
+        m_channel_count = channel_count;
+        m_stream_channel_count = channel_count;
+        m_sample_rate = sample_rate;
+        m_packet_frames = packet_frames;
+        m_slot_count = slot_count;
+        m_slots.reset(new Slot[slot_count]);
+        for (int i = 0; i < slot_count; i++) {
+            m_slots[i].tag = 0;
+            m_slots[i].samples.resize(packet_frames * channel_count);
+        }
+
+        m_have_transit = false;
+        m_last_transit = 0.0;
+        m_transit_sum = 0.0;
+        m_jitter_estimate = 0.0;
+        m_have_first = false;
+        m_highest = 0;
+        m_jitter = 0.0;
+        m_transit_time = 0.0;
+        m_min_packets = 2;
+        m_target_packets = 2;
+        m_resync_requested = false;
+        m_resync_ready = false;
+        m_resync_sequence = 0;
+
+        m_expected = 0;
+        m_playing = false;
+        // One spare frame for drift correction repeats
+        m_current.resize((packet_frames + 1) * channel_count);
+        m_current_pos = 0;
+        m_current_end = 0;
+        m_losses = 0;
+        m_average_fill = 0.0;
+
+        m_packets_received = 0;
+        m_packets_lost = 0;
+        m_packets_late = 0;
+        m_packets_overrun = 0;
+        m_drift_corrections = 0;
+        m_running = false;
+    }
+
+    UdpReceiver::~UdpReceiver()
+    {
+        stop();
+        close(m_socket);
+    }
+
+    void UdpReceiver::attach(OutStream* outstream)
+    {
+        if (outstream->get_format() !=
+                static_cast<FormatId>(SoundIoFormatFloat32NE)) {
+            throw soundio_error(ErrorId::IncompatibleDevice);
+        }
+        m_interleaved.resize(4096 * m_channel_count);
+        // get_layout() allocates, so it stays off the audio thread
+        m_stream_channel_count = outstream->get_layout().get_channel_count();
+        outstream->set_write_callback(
+            [this](OutStream* stream, int frame_count_min, int frame_count_max)
+            {
+                write(stream, frame_count_min, frame_count_max);
+            }
+        );
+    }
+
+    void UdpReceiver::read(float* interleaved, int frame_count)
+    {
+        int frame = 0;
+        while (frame < frame_count) {
+            if (m_current_pos == m_current_end) {
+                next_packet();
+            }
+            int chunk = m_current_end - m_current_pos;
+            if (chunk > frame_count - frame) {
+                chunk = frame_count - frame;
+            }
+            std::memcpy(interleaved + frame * m_channel_count,
+                m_current.data() + m_current_pos * m_channel_count,
+                chunk * m_channel_count * sizeof(float));
+            m_current_pos += chunk;
+            frame += chunk;
+        }
+    }
+
+    void UdpReceiver::start()
+    {
+        if (m_running) {
+            return;
+        }
+        m_running = true;
+        m_worker = std::thread(&UdpReceiver::run, this);
+    }
+
+    void UdpReceiver::stop()
+    {
+        m_running = false;
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+    }
+
+    // Getters/Setters
+
+    int UdpReceiver::get_port() const
+    {
+        return m_port;
+    }
+
+    int UdpReceiver::get_min_packets() const
+    {
+        return m_min_packets;
+    }
+
+    void UdpReceiver::set_min_packets(int min_packets)
+    {
+        m_min_packets = min_packets;
+    }
+
+    UdpReceiverStats UdpReceiver::get_stats() const
+    {
+        UdpReceiverStats stats;
+        stats.packets_received = m_packets_received.load();
+        stats.packets_lost = m_packets_lost.load();
+        stats.packets_late = m_packets_late.load();
+        stats.packets_overrun = m_packets_overrun.load();
+        stats.drift_corrections = m_drift_corrections.load();
+        stats.buffered_packets = m_have_first ?
+            sequence_diff(m_highest.load(), m_expected.load()) + 1 : 0;
+        if (stats.buffered_packets < 0) {
+            stats.buffered_packets = 0;
+        }
+        stats.target_packets = m_target_packets.load();
+        stats.jitter = m_jitter.load();
+        stats.transit_time = m_transit_time.load();
+        stats.buffer_latency = static_cast<double>(
+            stats.target_packets * m_packet_frames) / m_sample_rate;
+        return stats;
+    }
+
+    void UdpReceiver::run()
+    {
+        ThreadTuner::apply_worker();
+        size_t packet_size = sizeof(UdpPacketHeader)
+            + m_packet_frames * m_channel_count * sizeof(float);
+        std::vector<char> packets(packet_size * batch_size);
+        mmsghdr messages[batch_size];
+        iovec vectors[batch_size];
+
+        while (m_running) {
+            for (int i = 0; i < batch_size; i++) {
+                vectors[i].iov_base = packets.data() + i * packet_size;
+                vectors[i].iov_len = packet_size;
+                messages[i] = mmsghdr();
+                messages[i].msg_hdr.msg_iov = &vectors[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+            }
+            int count = recvmmsg(m_socket, messages, batch_size, 0, nullptr);
+            if (count <= 0) {
+                continue;
+            }
+            double arrival = monotonic_ns() * 1e-9;
+            for (int i = 0; i < count; i++) {
+                receive(packets.data() + i * packet_size,
+                    static_cast<int>(messages[i].msg_len), arrival);
+            }
+        }
+    }
+
+    void UdpReceiver::receive(const char* packet, int size, double arrival)
+    {
+        UdpPacketHeader header;
+        if (size < static_cast<int>(sizeof(header))) {
+            return;
+        }
+        std::memcpy(&header, packet, sizeof(header));
+        int samples = m_packet_frames * m_channel_count;
+        if (header.magic != packet_magic ||
+                header.channel_count != m_channel_count ||
+                header.frame_count != m_packet_frames ||
+                size < static_cast<int>(
+                    sizeof(header) + samples * sizeof(float))) {
+            return;
+        }
+        m_packets_received.fetch_add(1, std::memory_order_relaxed);
+
+        // Interarrival jitter as in RFC 3550
+        double transit = arrival - header.send_time * 1e-9;
+        if (m_have_transit) {
+            double d = std::fabs(transit - m_last_transit);
+            m_jitter_estimate += (d - m_jitter_estimate) / 16.0;
+            m_transit_sum += (transit - m_transit_sum) / 16.0;
+        } else {
+            m_transit_sum = transit;
+            m_have_transit = true;
+        }
+        m_last_transit = transit;
+        m_jitter.store(m_jitter_estimate, std::memory_order_relaxed);
+        m_transit_time.store(m_transit_sum, std::memory_order_relaxed);
+
+        double packet_duration =
+            static_cast<double>(m_packet_frames) / m_sample_rate;
+        int target = static_cast<int>(
+            std::ceil(3.0 * m_jitter_estimate / packet_duration)) + 1;
+        if (target < m_min_packets) {
+            target = m_min_packets;
+        }
+        if (target > m_slot_count / 2) {
+            target = m_slot_count / 2;
+        }
+        m_target_packets.store(target, std::memory_order_relaxed);
+
+        if (!m_have_first.load(std::memory_order_relaxed) ||
+                m_resync_requested.exchange(false, std::memory_order_acquire)) {
+            // Only this thread restarts the sequence, the audio thread takes
+            // it over in next_packet()
+            m_resync_sequence.store(header.sequence, std::memory_order_relaxed);
+            m_highest.store(header.sequence, std::memory_order_release);
+            m_resync_ready.store(true, std::memory_order_release);
+            m_have_first.store(true, std::memory_order_release);
+        }
+        uint32_t expected = m_resync_ready.load(std::memory_order_acquire) ?
+            m_resync_sequence.load(std::memory_order_relaxed) :
+            m_expected.load(std::memory_order_acquire);
+        int ahead = sequence_diff(header.sequence, expected);
+        if (ahead < 0) {
+            m_packets_late.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (ahead >= m_slot_count) {
+            m_packets_overrun.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        Slot& slot = m_slots[header.sequence % m_slot_count];
+        std::memcpy(slot.samples.data(), packet + sizeof(header),
+            samples * sizeof(float));
+        slot.tag.store(header.sequence + 1, std::memory_order_release);
+        if (sequence_diff(header.sequence, m_highest.load()) > 0) {
+            m_highest.store(header.sequence, std::memory_order_release);
+        }
+    }
+
+    void UdpReceiver::next_packet()
+    {
+        int samples = m_packet_frames * m_channel_count;
+        m_current_pos = 0;
+        m_current_end = m_packet_frames;
+        if (m_resync_ready.load(std::memory_order_acquire)) {
+            m_expected.store(m_resync_sequence.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+            m_resync_ready.store(false, std::memory_order_release);
+        }
+        uint32_t expected = m_expected.load(std::memory_order_relaxed);
+        int buffered = 0;
+        if (m_have_first.load(std::memory_order_acquire)) {
+            buffered = sequence_diff(
+                m_highest.load(std::memory_order_acquire), expected) + 1;
+        }
+        int target = m_target_packets.load(std::memory_order_relaxed);
+
+        if (!m_playing) {
+            if (buffered < target) {
+                std::memset(m_current.data(), 0, samples * sizeof(float));
+                return;
+            }
+            m_playing = true;
+            m_average_fill = buffered;
+        }
+
+        Slot& slot = m_slots[expected % m_slot_count];
+        if (slot.tag.load(std::memory_order_acquire) == expected + 1) {
+            std::memcpy(m_current.data(), slot.samples.data(),
+                samples * sizeof(float));
+            slot.tag.store(0, std::memory_order_relaxed);
+            m_losses = 0;
+        } else {
+            // Conceal by repeating the last packet, fading out
+            m_packets_lost.fetch_add(1, std::memory_order_relaxed);
+            m_losses++;
+            for (int i = 0; i < samples; i++) {
+                m_current[i] *= 0.5f;
+            }
+            if (buffered <= 0) {
+                // Ran dry, build the buffer up again
+                m_playing = false;
+                if (m_losses > target) {
+                    m_resync_requested.store(true, std::memory_order_release);
+                }
+            }
+        }
+        m_expected.store(expected + 1, std::memory_order_release);
+
+        m_average_fill += (buffered - m_average_fill) * 0.01;
+        if (m_average_fill > target + 1.5) {
+            // Sender clock runs fast, drop a frame
+            m_current_pos = 1;
+            m_average_fill = target;
+            m_drift_corrections.fetch_add(1, std::memory_order_relaxed);
+        } else if (m_average_fill < target - 1.5 && m_losses == 0) {
+            // Sender clock runs slow, repeat the last frame
+            std::memcpy(m_current.data() + samples,
+                m_current.data() + samples - m_channel_count,
+                m_channel_count * sizeof(float));
+            m_current_end = m_packet_frames + 1;
+            m_average_fill = target;
+            m_drift_corrections.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void UdpReceiver::write(OutStream* outstream, int frame_count_min,
+        int frame_count_max)
+    {
+        (void)frame_count_min;
+        int max_frames = static_cast<int>(m_interleaved.size())
+            / m_channel_count;
+        int frames_left = frame_count_max;
+        while (frames_left > 0) {
+            int request = frames_left < max_frames ? frames_left : max_frames;
+            ChannelArea* areas;
+            int frame_count = outstream->begin_write(areas, request);
+            if (frame_count == 0) {
+                break;
+            }
+            read(m_interleaved.data(), frame_count);
+            for (int ch = 0; ch < m_stream_channel_count; ch++) {
+                char* ptr = areas[ch].ptr;
+                for (int i = 0; i < frame_count; i++) {
+                    float sample = ch < m_channel_count ?
+                        m_interleaved[i * m_channel_count + ch] : 0.0f;
+                    std::memcpy(ptr, &sample, sizeof(float));
+                    ptr += areas[ch].step;
+                }
+            }
+            outstream->end_write();
+            frames_left -= frame_count;
+        }
+    }
+}
@@ -0,0 +1,467 @@
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/virtualbackend.h"
+
+namespace sio
+{
+    VirtualBackend::VirtualBackend()
+    {
+        m_time = 0.0;
+        m_period = 0.01;
+        m_jitter = 0.0;
+        m_random_state = 1;
+    }
+
+    OutStream VirtualBackend::create_outstream()
+    {
+        return OutStream(this);
+    }
+
+    InStream VirtualBackend::create_instream()
+    {
+        return InStream(this);
+    }
+
+    void VirtualBackend::run(double seconds)
+    {
+        double end_time = m_time + seconds;
+        while (true) {
+            size_t next = m_streams.size();
+            for (size_t i = 0; i < m_streams.size(); i++) {
+                VirtualStream& stream = m_streams[i];
+                if (!stream.running || stream.next_wakeup > end_time) {
+                    continue;
+                }
+                if (next == m_streams.size() ||
+                        stream.next_wakeup < m_streams[next].next_wakeup) {
+                    next = i;
+                }
+            }
+            if (next == m_streams.size()) {
+                break;
+            }
+
+            m_time = m_streams[next].next_wakeup;
+            if (m_streams[next].outstream != nullptr) {
+                service_output(next);
+            } else {
+                service_input(next);
+            }
+        }
+        m_time = end_time;
+    }
+
+    void VirtualBackend::force_xrun()
+    {
+        for (size_t i = 0; i < m_streams.size(); i++) {
+            m_streams[i].xrun = true;
+        }
+    }
+
+    // Getters/Setters
+
+    double VirtualBackend::get_time() const
+    {
+        return m_time;
+    }
+
+    double VirtualBackend::get_period() const
+    {
+        return m_period;
+    }
+
+    void VirtualBackend::set_period(double period)
+    {
+        // run() would never advance the clock
+        if (!(period > 0.0)) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        m_period = period;
+    }
+
+    double VirtualBackend::get_jitter() const
+    {
+        return m_jitter;
+    }
+
+    void VirtualBackend::set_jitter(double jitter, uint32_t seed)
+    {
+        if (!(jitter >= 0.0)) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        m_jitter = jitter;
+        // xorshift gets stuck on zero
+        m_random_state = seed != 0 ? seed : 1;
+    }
+
+    std::vector<double> VirtualBackend::get_intervals() const
+    {
+        return m_intervals;
+    }
+
+    void VirtualBackend::set_intervals(const std::vector<double>& intervals)
+    {
+        for (size_t i = 0; i < intervals.size(); i++) {
+            if (!(intervals[i] > 0.0)) {
+                throw soundio_error(ErrorId::Invalid);
+            }
+        }
+        m_intervals = intervals;
+    }
+
+    std::vector<int> VirtualBackend::get_frame_counts() const
+    {
+        return m_frame_counts;
+    }
+
+    void VirtualBackend::set_frame_counts(const std::vector<int>& frame_counts)
+    {
+        m_frame_counts = frame_counts;
+    }
+
+    std::function<void(InStream*, ChannelArea*, int)>
+        VirtualBackend::get_capture_callback()
+    {
+        return m_capture_callback;
+    }
+
+    void VirtualBackend::set_capture_callback(
+        std::function<void(InStream*, ChannelArea*, int)> capture_callback)
+    {
+        m_capture_callback = capture_callback;
+    }
+
+    // Driver
+
+    void VirtualBackend::open(OutStream* outstream)
+    {
+        SoundIoOutStream* raw = *outstream;
+        if (raw->software_latency == 0.0) {
+            raw->software_latency = m_period * 2;
+        }
+        VirtualStream stream = VirtualStream();
+        stream.outstream = raw;
+        add_stream(stream, raw->software_latency, raw->sample_rate,
+            raw->bytes_per_frame, raw->bytes_per_sample,
+            raw->layout.channel_count);
+    }
+
+    void VirtualBackend::close(OutStream* outstream)
+    {
+        remove_stream(static_cast<SoundIoOutStream*>(*outstream));
+    }
+
+    void VirtualBackend::start(OutStream* outstream)
+    {
+        VirtualStream* stream = find(static_cast<SoundIoOutStream*>(*outstream));
+        stream->running = true;
+        stream->last_time = m_time;
+        stream->next_wakeup = m_time;
+    }
+
+    void VirtualBackend::pause(OutStream* outstream, bool paused)
+    {
+        VirtualStream* stream = find(static_cast<SoundIoOutStream*>(*outstream));
+        stream->running = !paused;
+        stream->last_time = m_time;
+        stream->next_wakeup = m_time;
+    }
+
+    void VirtualBackend::clear_buffer(OutStream* outstream)
+    {
+        find(static_cast<SoundIoOutStream*>(*outstream))->fill = 0.0;
+    }
+
+    ErrorId VirtualBackend::begin_write(OutStream* outstream,
+        ChannelArea*& areas, int& frame_count) noexcept
+    {
+        VirtualStream* stream =
+            lookup(static_cast<SoundIoOutStream*>(*outstream));
+        if (stream == nullptr) {
+            return ErrorId::Invalid;
+        }
+        if (frame_count > stream->budget) {
+            frame_count = stream->budget;
+        }
+        areas = stream->areas.data();
+        stream->pending = frame_count;
+        return ErrorId::None;
+    }
+
+    ErrorId VirtualBackend::end_write(OutStream* outstream) noexcept
+    {
+        VirtualStream* stream =
+            lookup(static_cast<SoundIoOutStream*>(*outstream));
+        if (stream == nullptr) {
+            return ErrorId::Invalid;
+        }
+        stream->fill += stream->pending;
+        stream->budget -= stream->pending;
+        stream->pending = 0;
+        return ErrorId::None;
+    }
+
+    double VirtualBackend::get_latency(OutStream* outstream)
+    {
+        VirtualStream* stream = find(static_cast<SoundIoOutStream*>(*outstream));
+        return stream->fill / stream->sample_rate;
+    }
+
+    void VirtualBackend::open(InStream* instream)
+    {
+        SoundIoInStream* raw = *instream;
+        if (raw->software_latency == 0.0) {
+            raw->software_latency = m_period * 2;
+        }
+        VirtualStream stream = VirtualStream();
+        stream.instream = raw;
+        add_stream(stream, raw->software_latency, raw->sample_rate,
+            raw->bytes_per_frame, raw->bytes_per_sample,
+            raw->layout.channel_count);
+    }
+
+    void VirtualBackend::close(InStream* instream)
+    {
+        remove_stream(static_cast<SoundIoInStream*>(*instream));
+    }
+
+    void VirtualBackend::start(InStream* instream)
+    {
+        VirtualStream* stream = find(static_cast<SoundIoInStream*>(*instream));
+        stream->running = true;
+        stream->last_time = m_time;
+        stream->next_wakeup = m_time + next_interval(*stream);
+    }
+
+    void VirtualBackend::pause(InStream* instream, bool paused)
+    {
+        VirtualStream* stream = find(static_cast<SoundIoInStream*>(*instream));
+        stream->running = !paused;
+        stream->last_time = m_time;
+        stream->next_wakeup = m_time + next_interval(*stream);
+    }
+
+    ErrorId VirtualBackend::begin_read(InStream* instream,
+        ChannelArea*& areas, int& frame_count) noexcept
+    {
+        VirtualStream* stream =
+            lookup(static_cast<SoundIoInStream*>(*instream));
+        if (stream == nullptr) {
+            return ErrorId::Invalid;
+        }
+        if (frame_count > stream->budget) {
+            frame_count = stream->budget;
+        }
+        areas = stream->areas.data();
+        if (m_capture_callback) {
+            // User code, must not escape the noexcept path
+            try {
+                m_capture_callback(instream, areas, frame_count);
+            } catch (...) {
+                return ErrorId::Streaming;
+            }
+        } else {
+            std::memset(stream->buffer.data(), 0,
+                frame_count * stream->bytes_per_frame);
+        }
+        stream->pending = frame_count;
+        return ErrorId::None;
+    }
+
+    ErrorId VirtualBackend::end_read(InStream* instream) noexcept
+    {
+        VirtualStream* stream =
+            lookup(static_cast<SoundIoInStream*>(*instream));
+        if (stream == nullptr) {
+            return ErrorId::Invalid;
+        }
+        stream->fill -= stream->pending;
+        stream->budget -= stream->pending;
+        stream->pending = 0;
+        return ErrorId::None;
+    }
+
+    double VirtualBackend::get_latency(InStream* instream)
+    {
+        VirtualStream* stream = find(static_cast<SoundIoInStream*>(*instream));
+        return stream->fill / stream->sample_rate;
+    }
+
+    VirtualBackend::VirtualStream* VirtualBackend::find(const void* stream)
+    {
+        VirtualStream* found = lookup(stream);
+        if (found == nullptr) {
+            throw soundio_error(ErrorId::NoSuchDevice);
+        }
+        return found;
+    }
+
+    VirtualBackend::VirtualStream* VirtualBackend::lookup(
+        const void* stream) noexcept
+    {
+        if (stream == nullptr) {
+            return nullptr;
+        }
+        for (size_t i = 0; i < m_streams.size(); i++) {
+            if (m_streams[i].outstream == stream ||
+                    m_streams[i].instream == stream) {
+                return &m_streams[i];
+            }
+        }
+        return nullptr;
+    }
+
+    void VirtualBackend::add_stream(VirtualStream& stream,
+        double software_latency, int sample_rate, int bytes_per_frame,
+        int bytes_per_sample, int channel_count)
+    {
+        stream.sample_rate = sample_rate;
+        stream.bytes_per_frame = bytes_per_frame;
+        stream.capacity = static_cast<int>(
+            std::ceil(software_latency * sample_rate));
+        m_streams.push_back(stream);
+
+        // Frames are not kept, every callback gets the start of the buffer
+        VirtualStream& added = m_streams.back();
+        added.buffer.resize(added.capacity * bytes_per_frame);
+        added.areas.resize(channel_count);
+        for (int ch = 0; ch < channel_count; ch++) {
+            added.areas[ch].ptr = added.buffer.data() + ch * bytes_per_sample;
+            added.areas[ch].step = bytes_per_frame;
+        }
+    }
+
+    void VirtualBackend::remove_stream(const void* stream)
+    {
+        // Every entry has a null outstream or instream, so null would
+        // match a stream of the other direction
+        if (stream == nullptr) {
+            return;
+        }
+        for (size_t i = 0; i < m_streams.size(); i++) {
+            if (m_streams[i].outstream == stream ||
+                    m_streams[i].instream == stream) {
+                m_streams.erase(m_streams.begin() + i);
+                return;
+            }
+        }
+    }
+
+    void VirtualBackend::service_output(size_t index)
+    {
+        // Callbacks may open or close streams, which moves m_streams, so
+        // the entry is looked up again after each one
+        SoundIoOutStream* outstream = m_streams[index].outstream;
+        VirtualStream* stream = &m_streams[index];
+        stream->fill -= (m_time - stream->last_time) * stream->sample_rate;
+        stream->last_time = m_time;
+        if (stream->xrun) {
+            stream->fill = -1.0;
+            stream->xrun = false;
+        }
+        if (stream->fill < 0.0) {
+            stream->fill = 0.0;
+            underflow_callback(outstream);
+            stream = lookup(outstream);
+            if (stream == nullptr) {
+                return;
+            }
+        }
+
+        int fill = static_cast<int>(stream->fill);
+        int period_frames = static_cast<int>(m_period * stream->sample_rate);
+        int frame_count_max = scripted_frame_count(
+            *stream, stream->capacity - fill);
+        int frame_count_min = period_frames - fill;
+        if (frame_count_min < 0) {
+            frame_count_min = 0;
+        }
+        if (frame_count_min > frame_count_max) {
+            frame_count_min = frame_count_max;
+        }
+
+        stream->budget = frame_count_max;
+        write_callback(outstream, frame_count_min, frame_count_max);
+        stream = lookup(outstream);
+        if (stream == nullptr) {
+            return;
+        }
+        stream->budget = 0;
+        stream->next_wakeup = m_time + next_interval(*stream);
+    }
+
+    void VirtualBackend::service_input(size_t index)
+    {
+        SoundIoInStream* instream = m_streams[index].instream;
+        VirtualStream* stream = &m_streams[index];
+        stream->fill += (m_time - stream->last_time) * stream->sample_rate;
+        stream->last_time = m_time;
+        if (stream->xrun) {
+            stream->fill = stream->capacity + 1.0;
+            stream->xrun = false;
+        }
+        if (stream->fill > stream->capacity) {
+            stream->fill = stream->capacity;
+            overflow_callback(instream);
+            stream = lookup(instream);
+            if (stream == nullptr) {
+                return;
+            }
+        }
+
+        int fill = static_cast<int>(stream->fill);
+        int period_frames = static_cast<int>(m_period * stream->sample_rate);
+        int frame_count_max = scripted_frame_count(*stream, fill);
+        int frame_count_min = fill + period_frames - stream->capacity;
+        if (frame_count_min < 0) {
+            frame_count_min = 0;
+        }
+        if (frame_count_min > frame_count_max) {
+            frame_count_min = frame_count_max;
+        }
+
+        stream->budget = frame_count_max;
+        read_callback(instream, frame_count_min, frame_count_max);
+        stream = lookup(instream);
+        if (stream == nullptr) {
+            return;
+        }
+        stream->budget = 0;
+        stream->next_wakeup = m_time + next_interval(*stream);
+    }
+
+    double VirtualBackend::next_interval(VirtualStream& stream)
+    {
+        if (!m_intervals.empty()) {
+            return m_intervals[stream.callback_index++ % m_intervals.size()];
+        }
+        stream.callback_index++;
+        if (m_jitter == 0.0) {
+            return m_period;
+        }
+        m_random_state ^= m_random_state << 13;
+        m_random_state ^= m_random_state >> 17;
+        m_random_state ^= m_random_state << 5;
+        // Uniform in [period - jitter, period + jitter), kept positive so
+        // the clock always moves forward
+        double interval = m_period
+            + m_jitter * (2.0 * (m_random_state / 4294967296.0) - 1.0);
+        double shortest = m_period * 0.01;
+        return interval > shortest ? interval : shortest;
+    }
+
+    int VirtualBackend::scripted_frame_count(
+        VirtualStream& stream, int frame_count)
+    {
+        if (m_frame_counts.empty()) {
+            return frame_count;
+        }
+        int scripted = m_frame_counts[
+            stream.callback_index % m_frame_counts.size()];
+        return scripted < frame_count ? scripted : frame_count;
+    }
+}
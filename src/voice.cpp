@@ -0,0 +1,391 @@
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/voice.h"
+
+namespace sio
+{
+    VoiceParams::VoiceParams()
+    {
+        gain = 1.0f;
+        pan = 0.0f;
+        pitch = 1.0f;
+        start_frame = 0;
+        loop = false;
+        priority = 0;
+    }
+
+    VoiceEngine::VoiceEngine(int voice_count, int sample_rate,
+        int command_capacity)
+        : m_queue(command_capacity)
+    {
+        m_voices.resize(voice_count);
+        for (Voice& voice : m_voices) {
+            voice.id = 0;
+            voice.active = false;
+        }
+        m_left.resize(max_block);
+        m_right.resize(max_block);
+        m_sample_rate = sample_rate;
+        m_channel_count = 2;
+        m_started = 0;
+        m_next_id = 1;
+        m_active_voices = 0;
+        m_stolen_voices = 0;
+        m_dropped_commands = 0;
+    }
+
+    void VoiceEngine::attach(OutStream* outstream)
+    {
+        if (outstream->get_format() !=
+                static_cast<FormatId>(SoundIoFormatFloat32NE)) {
+            throw soundio_error(ErrorId::IncompatibleDevice);
+        }
+        m_sample_rate = outstream->get_sample_rate();
+        m_channel_count = outstream->get_layout().get_channel_count();
+        outstream->set_write_callback(
+            [this](OutStream* stream, int frame_count_min, int frame_count_max)
+            {
+                write(stream, frame_count_min, frame_count_max);
+            }
+        );
+    }
+
+    void VoiceEngine::render(float* left, float* right, int frame_count)
+    {
+        std::memset(left, 0, frame_count * sizeof(float));
+        std::memset(right, 0, frame_count * sizeof(float));
+        drain();
+
+        int active_voices = 0;
+        for (Voice& voice : m_voices) {
+            if (!voice.active) {
+                continue;
+            }
+            mix(voice, left, right, frame_count);
+            if (voice.active) {
+                active_voices++;
+            }
+        }
+        m_active_voices.store(active_voices, std::memory_order_relaxed);
+    }
+
+    VoiceId VoiceEngine::play(const VoiceSample& sample,
+        const VoiceParams& params)
+    {
+        if (!(params.pitch > 0.0f)) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        Command command;
+        command.type = CommandType::Play;
+        command.id = m_next_id.fetch_add(1);
+        if (command.id == 0) {
+            // Wrapped around, 0 is reserved for dropped commands
+            command.id = m_next_id.fetch_add(1);
+        }
+        command.sample = sample;
+        command.params = params;
+        if (!m_queue.push(command)) {
+            m_dropped_commands.fetch_add(1);
+            return 0;
+        }
+        return command.id;
+    }
+
+    void VoiceEngine::stop(VoiceId id)
+    {
+        Command command;
+        command.type = CommandType::Stop;
+        command.id = id;
+        push(command);
+    }
+
+    void VoiceEngine::set_voice(VoiceId id, float gain, float pan, float pitch)
+    {
+        if (!(pitch > 0.0f)) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        Command command;
+        command.type = CommandType::Update;
+        command.id = id;
+        command.params.gain = gain;
+        command.params.pan = pan;
+        command.params.pitch = pitch;
+        push(command);
+    }
+
+    void VoiceEngine::stop_all()
+    {
+        Command command;
+        command.type = CommandType::StopAll;
+        command.id = 0;
+        push(command);
+    }
+
+    // Getters/Setters
+
+    int VoiceEngine::get_sample_rate() const
+    {
+        return m_sample_rate;
+    }
+
+    void VoiceEngine::set_sample_rate(int sample_rate)
+    {
+        if (sample_rate < 1) {
+            throw soundio_error(ErrorId::Invalid);
+        }
+        m_sample_rate = sample_rate;
+    }
+
+    int VoiceEngine::get_active_voices() const
+    {
+        return m_active_voices.load(std::memory_order_relaxed);
+    }
+
+    unsigned VoiceEngine::get_stolen_voices() const
+    {
+        return m_stolen_voices.load(std::memory_order_relaxed);
+    }
+
+    unsigned VoiceEngine::get_dropped_commands() const
+    {
+        return m_dropped_commands.load(std::memory_order_relaxed);
+    }
+
+    void VoiceEngine::write(OutStream* outstream, int frame_count_min,
+        int frame_count_max)
+    {
+        (void)frame_count_min;
+        int channel_count = m_channel_count;
+        int frames_left = frame_count_max;
+        while (frames_left > 0) {
+            ChannelArea* areas;
+            int frame_count = frames_left;
+            if (outstream->try_begin_write(areas, frame_count)
+                    != ErrorId::None || frame_count == 0) {
+                break;
+            }
+
+            for (int frame = 0; frame < frame_count; frame += max_block) {
+                int chunk = frame_count - frame;
+                if (chunk > max_block) {
+                    chunk = max_block;
+                }
+                render(m_left.data(), m_right.data(), chunk);
+                if (channel_count == 1) {
+                    for (int i = 0; i < chunk; i++) {
+                        m_left[i] += m_right[i];
+                    }
+                }
+                for (int ch = 0; ch < channel_count; ch++) {
+                    char* ptr = areas[ch].ptr + frame * areas[ch].step;
+                    for (int i = 0; i < chunk; i++) {
+                        float sample = ch == 0 ? m_left[i] :
+                            ch == 1 ? m_right[i] : 0.0f;
+                        std::memcpy(ptr, &sample, sizeof(float));
+                        ptr += areas[ch].step;
+                    }
+                }
+            }
+
+            if (outstream->try_end_write() != ErrorId::None) {
+                break;
+            }
+            frames_left -= frame_count;
+        }
+    }
+
+    void VoiceEngine::push(const Command& command)
+    {
+        if (!m_queue.push(command)) {
+            m_dropped_commands.fetch_add(1);
+        }
+    }
+
+    void VoiceEngine::drain()
+    {
+        Command command;
+        while (m_queue.pop(command)) {
+            if (command.type == CommandType::Play) {
+                start(command);
+                continue;
+            }
+            if (command.type == CommandType::StopAll) {
+                for (Voice& voice : m_voices) {
+                    voice.stopping = true;
+                }
+                continue;
+            }
+            Voice* voice = find(command.id);
+            if (voice == nullptr) {
+                continue;
+            }
+            if (command.type == CommandType::Stop) {
+                voice->stopping = true;
+            } else {
+                voice->gain = command.params.gain;
+                voice->pan = command.params.pan;
+                voice->pitch = command.params.pitch;
+                voice->step = static_cast<double>(voice->pitch)
+                    * voice->sample.sample_rate / m_sample_rate;
+            }
+        }
+    }
+
+    void VoiceEngine::start(const Command& command)
+    {
+        const VoiceSample& sample = command.sample;
+        if (sample.frame_count < 2 || sample.channel_count < 1 ||
+                sample.channel_count > 2 || sample.sample_rate < 1 ||
+                command.params.start_frame >= sample.frame_count - 1) {
+            return;
+        }
+
+        Voice* target = nullptr;
+        for (Voice& voice : m_voices) {
+            if (!voice.active) {
+                target = &voice;
+                break;
+            }
+        }
+        if (target == nullptr) {
+            for (Voice& voice : m_voices) {
+                if (target == nullptr || voice.priority < target->priority ||
+                        (voice.priority == target->priority &&
+                            voice.age < target->age)) {
+                    target = &voice;
+                }
+            }
+            if (target == nullptr ||
+                    target->priority > command.params.priority) {
+                return;
+            }
+            m_stolen_voices.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Voice& voice = *target;
+        voice.id = command.id;
+        voice.active = true;
+        voice.stopping = false;
+        voice.sample = sample;
+        voice.position = command.params.start_frame;
+        voice.pitch = command.params.pitch;
+        voice.step = static_cast<double>(voice.pitch)
+            * sample.sample_rate / m_sample_rate;
+        voice.gain = command.params.gain;
+        voice.pan = command.params.pan;
+        // Start at the final gains, a ramp would soften the attack
+        float angle = (voice.pan + 1.0f) * 0.785398163f;
+        voice.left = voice.gain * std::cos(angle);
+        voice.right = voice.gain * std::sin(angle);
+        voice.loop = command.params.loop;
+        voice.priority = command.params.priority;
+        voice.age = m_started++;
+    }
+
+    VoiceEngine::Voice* VoiceEngine::find(VoiceId id)
+    {
+        for (Voice& voice : m_voices) {
+            if (voice.active && voice.id == id) {
+                return &voice;
+            }
+        }
+        return nullptr;
+    }
+
+    void VoiceEngine::mix(Voice& voice, float* left, float* right,
+        int frame_count)
+    {
+        // Constant power pan, ramped to the new gains across the block
+        float target_left = 0.0f;
+        float target_right = 0.0f;
+        if (!voice.stopping) {
+            float angle = (voice.pan + 1.0f) * 0.785398163f;
+            target_left = voice.gain * std::cos(angle);
+            target_right = voice.gain * std::sin(angle);
+        }
+        float gain_left = voice.left;
+        float gain_right = voice.right;
+        float delta_left = (target_left - gain_left) / frame_count;
+        float delta_right = (target_right - gain_right) / frame_count;
+
+        const float* samples = voice.sample.samples;
+        // Interpolation reads one frame ahead
+        double last = voice.sample.frame_count - 1;
+        double step = voice.step;
+        if (!(step > 0.0)) {
+            // Would never advance, only reachable with a bad output rate
+            voice.active = false;
+            return;
+        }
+        int frame = 0;
+        while (frame < frame_count) {
+            if (voice.position >= last) {
+                if (!voice.loop) {
+                    voice.active = false;
+                    return;
+                }
+                voice.position = std::fmod(voice.position, last);
+            }
+            int run = static_cast<int>(
+                std::ceil((last - voice.position) / step));
+            if (run > frame_count - frame) {
+                run = frame_count - frame;
+            }
+
+            // Straight loops without bounds checks so the compiler can
+            // vectorise them
+            double position = voice.position;
+            float* out_left = left + frame;
+            float* out_right = right + frame;
+            if (voice.sample.channel_count == 1) {
+                if (step == 1.0 && position == std::floor(position)) {
+                    const float* in = samples + static_cast<int>(position);
+                    for (int i = 0; i < run; i++) {
+                        out_left[i] += in[i] * gain_left;
+                        out_right[i] += in[i] * gain_right;
+                        gain_left += delta_left;
+                        gain_right += delta_right;
+                    }
+                    position += run;
+                } else {
+                    for (int i = 0; i < run; i++) {
+                        int index = static_cast<int>(position);
+                        float fraction = static_cast<float>(position - index);
+                        float a = samples[index];
+                        float sample = a + (samples[index + 1] - a) * fraction;
+                        out_left[i] += sample * gain_left;
+                        out_right[i] += sample * gain_right;
+                        gain_left += delta_left;
+                        gain_right += delta_right;
+                        position += step;
+                    }
+                }
+            } else {
+                for (int i = 0; i < run; i++) {
+                    int index = static_cast<int>(position);
+                    float fraction = static_cast<float>(position - index);
+                    const float* a = samples + index * 2;
+                    float sample_left = a[0] + (a[2] - a[0]) * fraction;
+                    float sample_right = a[1] + (a[3] - a[1]) * fraction;
+                    out_left[i] += sample_left * gain_left;
+                    out_right[i] += sample_right * gain_right;
+                    gain_left += delta_left;
+                    gain_right += delta_right;
+                    position += step;
+                }
+            }
+            voice.position = position;
+            frame += run;
+        }
+
+        voice.left = target_left;
+        voice.right = target_right;
+        if (voice.stopping) {
+            voice.active = false;
+        }
+    }
+}
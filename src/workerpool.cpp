@@ -0,0 +1,178 @@
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "soundio/soundio.h"
+#include "soundiopp/soundiopp.h"
+#include "soundiopp/workerpool.h"
+#include "soundiopp/threading.h"
+
+namespace sio
+{
+    WorkItem::WorkItem(std::function<void()> run)
+    {
+        m_state = static_cast<int>(WorkState::Idle);
+        m_run = run;
+    }
+
+    WorkState WorkItem::get_state() const
+    {
+        return static_cast<WorkState>(
+            m_state.load(std::memory_order_acquire));
+    }
+
+    bool WorkItem::is_done() const
+    {
+        return get_state() == WorkState::Done;
+    }
+
+    // Getters/Setters
+
+    std::function<void()> WorkItem::get_run()
+    {
+        return m_run;
+    }
+
+    void WorkItem::set_run(std::function<void()> run)
+    {
+        m_run = run;
+    }
+
+    WorkerPool::WorkerPool(int thread_count, int queue_capacity)
+        : m_queue(queue_capacity)
+    {
+        m_thread_count = thread_count;
+        m_running = false;
+        m_poll_interval = 0.001;
+        m_rejected = 0;
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        stop();
+    }
+
+    void WorkerPool::start()
+    {
+        if (m_running) {
+            return;
+        }
+        m_running = true;
+        for (int i = 0; i < m_thread_count; i++) {
+            m_workers.push_back(std::thread(&WorkerPool::run, this));
+        }
+    }
+
+    void WorkerPool::stop()
+    {
+        m_running = false;
+        for (size_t i = 0; i < m_workers.size(); i++) {
+            m_workers[i].join();
+        }
+        m_workers.clear();
+        // Nothing queued is lost, whatever is left runs here
+        drain();
+    }
+
+    bool WorkerPool::submit(WorkItem& item)
+    {
+        int state = item.m_state.load(std::memory_order_acquire);
+        if (state == static_cast<int>(WorkState::Queued) ||
+                state == static_cast<int>(WorkState::Running)) {
+            return false;
+        }
+        item.m_state.store(static_cast<int>(WorkState::Queued),
+            std::memory_order_relaxed);
+        Task task = {&item, nullptr, nullptr};
+        if (!m_queue.push(task)) {
+            item.m_state.store(state, std::memory_order_relaxed);
+            m_rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    bool WorkerPool::retire(void (*deleter)(void*), void* object)
+    {
+        Task task = {nullptr, deleter, object};
+        if (!m_queue.push(task)) {
+            m_rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    int WorkerPool::drain()
+    {
+        int count = 0;
+        while (run_one()) {
+            count++;
+        }
+        return count;
+    }
+
+    // Getters/Setters
+
+    int WorkerPool::get_thread_count() const
+    {
+        return m_thread_count;
+    }
+
+    double WorkerPool::get_poll_interval() const
+    {
+        return m_poll_interval.load();
+    }
+
+    void WorkerPool::set_poll_interval(double poll_interval)
+    {
+        m_poll_interval = poll_interval;
+    }
+
+    unsigned long long WorkerPool::get_rejected() const
+    {
+        return m_rejected.load();
+    }
+
+    bool WorkerPool::run_one()
+    {
+        Task task;
+        {
+            std::lock_guard<std::mutex> lock(m_pop_mutex);
+            if (!m_queue.pop(task)) {
+                return false;
+            }
+        }
+        if (task.item == nullptr) {
+            task.deleter(task.object);
+            return true;
+        }
+
+        WorkItem& item = *task.item;
+        item.m_state.store(static_cast<int>(WorkState::Running),
+            std::memory_order_relaxed);
+        WorkState result = WorkState::Done;
+        try {
+            if (item.m_run) {
+                item.m_run();
+            }
+        } catch (...) {
+            result = WorkState::Failed;
+        }
+        item.m_state.store(static_cast<int>(result),
+            std::memory_order_release);
+        return true;
+    }
+
+    void WorkerPool::run()
+    {
+        ThreadTuner::apply_worker();
+        while (m_running) {
+            if (!run_one()) {
+                std::this_thread::sleep_for(
+                    std::chrono::duration<double>(m_poll_interval.load()));
+            }
+        }
+    }
+}